@@ -0,0 +1,205 @@
+// interpreter benchmark driver
+// runs every workload in a directory through the interpreter and reports
+// ns/op, interpreted instructions/sec and peak RSS, optionally against a
+// baseline saved by an earlier run, and fails if a workload got slower than
+// the baseline by more than the threshold
+// usage: bench_driver atmo workloads [--baseline file] [--save file]
+//        [--threshold percent]
+#include "../src/_components.hh"
+#include <filesystem>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+struct Result {
+	std::string name;
+	double      nsPerOp;
+	double      instructionsPerSec;
+	long        peakRSS; // KiB
+};
+
+// workloads say how many operations they do on their first line, as
+// `// ops: N`, files without it (like modules they include) are skipped
+static size_t WorkloadOps(std::string path) {
+	std::ifstream file(path);
+	std::string   line;
+	std::getline(file, line);
+	if (line.rfind("// ops: ", 0) != 0) {
+		return 0;
+	}
+	return std::stoull(line.substr(8));
+}
+
+static bool Run(std::string atmo, std::string path, Result& result, size_t ops) {
+	int pipeFds[2];
+	if (pipe(pipeFds) != 0) {
+		perror("pipe");
+		return false;
+	}
+
+	auto  start = std::chrono::steady_clock::now();
+	pid_t pid   = fork();
+	if (pid == 0) {
+		// run from the workload's directory so includes resolve
+		std::filesystem::path file(path);
+		if (chdir(file.parent_path().c_str()) != 0) {
+			_exit(EXIT_FAILURE);
+		}
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		dup2(pipeFds[1], STDERR_FILENO);
+		close(pipeFds[0]);
+		// without the cache, every run lexes and compiles like the first one,
+		// and no .atmoc files are left in the workloads directory
+		std::string name = file.filename().string();
+		execl(
+			atmo.c_str(), atmo.c_str(), "--stats", "--no-cache", name.c_str(),
+			(char*) nullptr
+		);
+		_exit(127);
+	}
+	close(pipeFds[1]);
+
+	std::string errors;
+	char        buffer[4096];
+	ssize_t     got;
+	while ((got = read(pipeFds[0], buffer, sizeof(buffer))) > 0) {
+		errors.append(buffer, (size_t) got);
+	}
+	close(pipeFds[0]);
+
+	int           status;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+
+	size_t instructions = 0;
+	size_t pos          = errors.rfind("instructions: ");
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0) || (pos == std::string::npos)) {
+		fprintf(stderr, "[ERROR] %s failed:\n%s", path.c_str(), errors.c_str());
+		return false;
+	}
+	instructions = std::stoull(errors.substr(pos + 14));
+
+	result.nsPerOp            = elapsed.count() * 1e9 / (double) ops;
+	result.instructionsPerSec = (double) instructions / elapsed.count();
+	result.peakRSS            = usage.ru_maxrss;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(
+			stderr,
+			"usage: %s atmo workloads [--baseline file] [--save file] "
+			"[--threshold percent]\n", argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+	std::string atmo      = std::filesystem::absolute(argv[1]).string();
+	std::string dir       = argv[2];
+	std::string baseline  = "";
+	std::string save      = "";
+	double      threshold = 10.0; // percent
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "--baseline") == 0) {
+			baseline = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--save") == 0) {
+			save = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--threshold") == 0) {
+			threshold = atof(argv[i + 1]);
+		}
+	}
+
+	std::vector <std::string> paths;
+	for (auto& entry : std::filesystem::directory_iterator(dir)) {
+		if (entry.path().extension() == ".atmo") {
+			paths.push_back(entry.path().string());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+
+	// saved as `name ns/op` per line
+	std::unordered_map <std::string, double> previous;
+	if (baseline != "") {
+		std::ifstream file(baseline);
+		std::string   name;
+		double        nsPerOp;
+		while (file >> name >> nsPerOp) {
+			previous[name] = nsPerOp;
+		}
+	}
+
+	printf(
+		"%-12s %12s %16s %12s %10s\n",
+		"workload", "ns/op", "instructions/s", "peak RSS", "baseline"
+	);
+
+	const int            runs   = 5;
+	std::vector <Result> results;
+	bool                 failed = false;
+	// by how much, in percent
+	std::vector <std::pair <std::string, double>> regressions;
+	for (auto& path : paths) {
+		size_t ops = WorkloadOps(path);
+		if (ops == 0) {
+			continue;
+		}
+
+		// best of a few runs
+		Result best;
+		best.name = std::filesystem::path(path).stem().string();
+		for (int i = 0; i < runs; ++i) {
+			Result result;
+			if (!Run(atmo, path, result, ops)) {
+				failed = true;
+				break;
+			}
+			if ((i == 0) || (result.nsPerOp < best.nsPerOp)) {
+				best.nsPerOp            = result.nsPerOp;
+				best.instructionsPerSec = result.instructionsPerSec;
+			}
+			best.peakRSS = result.peakRSS;
+		}
+		if (failed) {
+			break;
+		}
+		results.push_back(best);
+
+		std::string change = "";
+		auto        old    = previous.find(best.name);
+		if (old != previous.end()) {
+			double percent = (best.nsPerOp / old->second - 1) * 100;
+			char   text[32];
+			snprintf(text, sizeof(text), "%+.1f%%", percent);
+			change = text;
+			if (percent > threshold) {
+				regressions.emplace_back(best.name, percent);
+			}
+		}
+		printf(
+			"%-12s %12.1f %14.1fM %9ld KiB %10s\n",
+			best.name.c_str(), best.nsPerOp, best.instructionsPerSec / 1e6,
+			best.peakRSS, change.c_str()
+		);
+	}
+
+	if ((save != "") && !failed) {
+		std::ofstream file(save);
+		for (auto& result : results) {
+			file << result.name << ' ' << result.nsPerOp << '\n';
+		}
+	}
+	fflush(stdout);
+	for (auto& regression : regressions) {
+		fprintf(
+			stderr, "[ERROR] %s is %.1f%% slower than the baseline, more than %.1f%%\n",
+			regression.first.c_str(), regression.second, threshold
+		);
+		failed = true;
+	}
+	return failed? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+// lexer throughput benchmark
+// usage: bench_lexer [files...] (defaults to the examples)
+#include "../src/_components.hh"
+#include "../src/fs.hh"
+#include "../src/lexer.hh"
+#include <filesystem>
+
+int main(int argc, char** argv) {
+	std::vector <std::string> files;
+	for (int i = 1; i < argc; ++i) {
+		files.push_back(argv[i]);
+	}
+	if (files.empty()) {
+		for (auto& entry : std::filesystem::directory_iterator("examples")) {
+			if (entry.path().extension() == ".atmo") {
+				files.push_back(entry.path().string());
+			}
+		}
+	}
+
+	// build a source about the size of a big program out of whole statements,
+	// lexing one huge source would mostly measure page faults
+	std::string corpus;
+	for (auto& file : files) {
+		auto source = FS::File::Load(file);
+		if (source == nullptr) {
+			fprintf(stderr, "[ERROR] Couldn't open %s: %s\n", file.c_str(), strerror(errno));
+			return EXIT_FAILURE;
+		}
+		corpus += std::string(source->View()) + "\n";
+	}
+	if (corpus.find_first_not_of("\n") == std::string::npos) {
+		fprintf(stderr, "[ERROR] Nothing to lex\n");
+		return EXIT_FAILURE;
+	}
+	std::string code;
+	while (code.length() < 64 * 1024) {
+		code += corpus;
+	}
+
+	const size_t runs   = (256 * 1024 * 1024) / code.length();
+	size_t       tokens = 0;
+	auto         start  = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < runs; ++i) {
+		tokens += Lexer::Lex(code, "bench").size();
+	}
+	std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double megabytes = (double) (code.length() * runs) / (1024 * 1024);
+	printf(
+		"lexer: %.2f MB in %.3fs, %.1f MB/s, %.1f Mtokens/s\n",
+		megabytes, elapsed.count(), megabytes / elapsed.count(),
+		(double) tokens / elapsed.count() / 1000000
+	);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+// map benchmark, fills maps of growing sizes with integer and string keys
+// and reports the time per operation and the memory each entry takes
+// usage: bench_map
+#include "../src/language.hh"
+
+static const size_t sizes[] = {1000, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+
+template <typename Function>
+static double Time(size_t count, Function function) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t j = 0; j < count; ++j) {
+		function(j);
+	}
+	std::chrono::duration <double, std::nano> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return elapsed.count() / count;
+}
+
+int main() {
+	printf(
+		"%-8s %9s %9s %9s %9s %12s %12s\n", "keys", "entries", "set", "hit", "miss",
+		"bytes/entry", "overhead"
+	);
+
+	bool ok = true;
+	for (int strings = 0; strings < 2; ++strings) {
+		for (size_t size : sizes) {
+			// made before timing, so only the map's work is measured. the keys
+			// looked up but never set are the odd ones
+			std::vector <Language::Value> keys;
+			for (size_t j = 0; j < size * 2; ++j) {
+				if (strings) {
+					keys.push_back(Language::String("key" + std::to_string(j * 7919)));
+				}
+				else {
+					keys.push_back((int32_t) (j * 7919));
+				}
+			}
+
+			Language::Map map;
+			size_t        found = 0;
+			double set = Time(size, [&](size_t j) {
+				map.Set(keys[j * 2], (size_t) j);
+			});
+			double hit = Time(size, [&](size_t j) {
+				found += map.Find(keys[j * 2]) != nullptr;
+			});
+			double miss = Time(size, [&](size_t j) {
+				found += map.Find(keys[j * 2 + 1]) != nullptr;
+			});
+			if ((found != size) || (map.Size() != size)) {
+				ok = false;
+			}
+
+			// the key and the value are the payload, anything else the map
+			// allocates per entry is overhead. strings' text isn't counted
+			double bytes = (double) map.MemoryUsed() / size;
+			printf(
+				"%-8s %9llu %9.1f %9.1f %9.1f %12.1f %12.1f\n",
+				strings? "string" : "integer", (unsigned long long int) size, set, hit,
+				miss, bytes, bytes - 2 * sizeof(Language::Value)
+			);
+		}
+	}
+	printf("set, hit and miss are ns per operation\n");
+
+	if (!ok) {
+		fprintf(stderr, "[ERROR] The map lost entries\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+// string kernel benchmark, runs every set of kernels the CPU supports on
+// the same inputs, checks they agree and compares them to the scalar ones
+// usage: bench_strings
+#include "../src/_components.hh"
+#include "../src/simd.hh"
+#include <functional>
+
+// every kernel is run on short strings, like the ones scripts mostly handle,
+// and on long ones
+static const size_t lengths[] = {16, 100, 4096, 1024 * 1024};
+
+struct Result {
+	size_t value;
+	double nanoseconds; // per call
+};
+
+template <typename Function>
+static Result Time(size_t bytes, Function function) {
+	// about the same amount of work for every length
+	size_t runs  = std::max((size_t) 8, (size_t) (64 * 1024 * 1024) / bytes);
+	size_t value = 0;
+	auto   start = std::chrono::steady_clock::now();
+	for (size_t j = 0; j < runs; ++j) {
+		value += function();
+	}
+	std::chrono::duration <double, std::nano> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return {value / runs, elapsed.count() / runs};
+}
+
+int main() {
+	auto kernels = SIMD::Supported();
+
+	printf("%-12s %9s", "kernel", "length");
+	for (auto set : kernels) {
+		printf(" %10s", set->name);
+	}
+	printf("   ns/call, speedup over %s\n", kernels[0]->name);
+
+	bool ok = true;
+	for (size_t length : lengths) {
+		// text with the byte looked for now and then, and the needle at the end
+		std::string text(length, ' ');
+		for (size_t j = 0; j < length; ++j) {
+			text[j] = "the quick brown fox jumps over a lazy dog "[j % 42];
+		}
+		std::string needle = "NEEDLE";
+		text.replace(length - needle.length(), needle.length(), needle);
+		std::string same    = text;
+		same.back()         = '!';
+		std::string lower   = text;
+		std::string lowered = text;
+		SIMD::scalar.changeCase(lowered.data(), lowered.length(), false);
+
+		std::pair <const char*, std::function <size_t(const SIMD::Kernels&)>> benchmarks[] = {
+			{"find_byte", [&](const SIMD::Kernels& k) {
+				return k.findByte(text.data(), text.length(), 'N');
+			}},
+			{"find", [&](const SIMD::Kernels& k) {
+				return k.find(text.data(), text.length(), needle.data(), needle.length());
+			}},
+			{"count_byte", [&](const SIMD::Kernels& k) {
+				return k.countByte(text.data(), text.length(), 'o');
+			}},
+			{"mismatch", [&](const SIMD::Kernels& k) {
+				return k.mismatch(text.data(), same.data(), text.length());
+			}},
+			{"change_case", [&](const SIMD::Kernels& k) {
+				// upper then lower, so every run starts from the same text
+				k.changeCase(lower.data(), lower.length(), true);
+				k.changeCase(lower.data(), lower.length(), false);
+				return (size_t) lower[length / 2];
+			}}
+		};
+
+		for (auto& benchmark : benchmarks) {
+			printf("%-12s %9llu", benchmark.first, (unsigned long long int) length);
+			std::vector <Result> results;
+			for (auto set : kernels) {
+				results.push_back(Time(length, [&]() {
+					return benchmark.second(*set);
+				}));
+				printf(" %10.1f", results.back().nanoseconds);
+				if (results.back().value != results[0].value) {
+					ok = false;
+				}
+			}
+			printf("   %.1fx\n", results[0].nanoseconds / results.back().nanoseconds);
+		}
+		if (lower != lowered) {
+			ok = false;
+		}
+	}
+
+	if (!ok) {
+		fprintf(stderr, "[ERROR] The kernels gave different results\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
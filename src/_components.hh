@@ -4,13 +4,23 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <math.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
 
 // C++ standard libraries
 #include <string>
+#include <string_view>
+#include <memory>
+#include <new>
 #include <vector>
 #include <chrono>
 #include <thread>
 #include <fstream>
 #include <variant>
+#include <charconv>
+#include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <algorithm>
+#include <type_traits>
@@ -1,12 +1,39 @@
 #include "app.hh"
 #include "constants.hh"
 #include "fs.hh"
+#include "cache.hh"
 #include "lexer.hh"
 #include "util.hh"
 #include "language.hh"
 #include "interpreter.hh"
+#include "checker.hh"
 #include "repl.hh"
 
+// the program can exit from anywhere, so --stats and --profile are
+// reported at exit
+static Language::LanguageComponents* reportLc    = nullptr;
+static bool                          reportStats = false;
+static std::thread::id               reportThread;
+
+static void Report() {
+	// a spawned label's exit can't touch the program's lc, which is still
+	// being run
+	if ((reportLc == nullptr) || (std::this_thread::get_id() != reportThread)) {
+		return;
+	}
+	reportLc->output.Flush();
+	if (reportStats) {
+		fprintf(
+			stderr, "instructions: %llu\n", (unsigned long long int) reportLc->executed
+		);
+	}
+	if (reportLc->profiler != nullptr) {
+		reportLc->profiler->PrintTable(stderr);
+		reportLc->profiler->WriteFolded("atmo.folded");
+	}
+	reportLc = nullptr;
+}
+
 App::App(int argc, char** argv) {
 	for (int i = 0; i < argc; ++i) {
 		args.push_back(argv[i]);
@@ -14,15 +41,30 @@ App::App(int argc, char** argv) {
 
 	std::string programPath = "";
 	bool        lexerDebug  = false;
+	bool        codeDebug   = false;
+	bool        stats       = false;
+	bool        profile     = false;
+	size_t      maxDepth    = 0;
 	if (argc > 1) {
 		for (size_t i = 1; i < args.size(); ++i) {
 			if ((programPath == "") && (args[i][0] == '-')) {
 				if ((args[i] == "-h") || (args[i] == "--help")) {
 					printf(
 						"Usage: %s [options/path]\n"
-						"    -h / --help    : show this menu\n"
-						"    -v / --version : show version\n"
-						"    -d / --debug   : debug lexer tokens\n",
+						"    -h / --help        : show this menu\n"
+						"    -v / --version     : show version\n"
+						"    -d / --debug       : debug lexer tokens\n"
+						"    -b / --bytecode    : debug compiled bytecode\n"
+						"    -s / --stats       : print the number of instructions run on exit\n"
+						"    -p / --profile     : print time spent in labels and builtins on\n"
+						"                         exit and write folded stacks to atmo.folded\n"
+						"    -m / --max-depth N : allow N nested label calls (default 100000)\n"
+						"    -t / --threads N   : run spawned labels on N threads (default one\n"
+						"                         per core)\n"
+						"    -n / --no-cache    : always lex from source, don't use or write\n"
+						"                         .atmoc files (written next to the source, or\n"
+						"                         to $ATMO_CACHE_DIR if it is set)\n"
+						"    --no-opt           : don't fuse common instruction sequences\n",
 						argv[0]
 					);
 					return;
@@ -34,6 +76,37 @@ App::App(int argc, char** argv) {
 				else if ((args[i] == "-d") || (args[i] == "--debug")) {
 					lexerDebug = true;
 				}
+				else if ((args[i] == "-b") || (args[i] == "--bytecode")) {
+					codeDebug = true;
+				}
+				else if ((args[i] == "-s") || (args[i] == "--stats")) {
+					stats = true;
+				}
+				else if ((args[i] == "-p") || (args[i] == "--profile")) {
+					profile = true;
+				}
+				else if ((args[i] == "-n") || (args[i] == "--no-cache")) {
+					Cache::enabled = false;
+				}
+				else if (args[i] == "--no-opt") {
+					Bytecode::optimise = false;
+				}
+				else if ((args[i] == "-m") || (args[i] == "--max-depth")) {
+					if ((i + 1 >= args.size()) || !isdigit(args[i + 1][0])) {
+						fprintf(stderr, "[ERROR] %s needs a number\n", args[i].c_str());
+						exit(EXIT_FAILURE);
+					}
+					maxDepth = std::stoull(args[i + 1]);
+					++ i;
+				}
+				else if ((args[i] == "-t") || (args[i] == "--threads")) {
+					if ((i + 1 >= args.size()) || !isdigit(args[i + 1][0])) {
+						fprintf(stderr, "[ERROR] %s needs a number\n", args[i].c_str());
+						exit(EXIT_FAILURE);
+					}
+					Pool::SetWorkers(std::stoull(args[i + 1]));
+					++ i;
+				}
 			}
 			else {
 				programPath = args[i];
@@ -44,27 +117,70 @@ App::App(int argc, char** argv) {
 	else {
 		// run repl
 		Repl();
+		return;
 	}
 
-	if (!FS::File::Exists(programPath)) {
-		fprintf(stderr, "[ERROR] No such file: %s\n", programPath.c_str());
+	// tokens point into the source, so it has to live as long as the program
+	Language::LanguageComponents lc;
+	std::vector <Lexer::Token>   tokens;
+	std::string                  lexName = Util::BaseName(programPath);
+	bool                         failed  = false;
+	auto code = lexerDebug?
+		Cache::Tokens(programPath, lexName, tokens, failed) :
+		Cache::Program(programPath, lexName, lc, failed);
+	if (code == nullptr) {
+		fprintf(
+			stderr, "[ERROR] Couldn't open %s: %s\n", programPath.c_str(), strerror(errno)
+		);
+		exit(EXIT_FAILURE);
+	}
+	// the lexer has reported the errors
+	if (failed) {
+		exit(EXIT_FAILURE);
 	}
-
-	std::string                code = FS::File::Read(programPath);
-	std::vector <Lexer::Token> tokens = Lexer::Lex(code, Util::BaseName(programPath));
 
 	if (lexerDebug) {
 		Lexer::Visualise(tokens);
 		return;
 	}
 
-	if (tokens.empty()) {
+	if (lc.program->code.empty()) {
+		return;
+	}
+
+	Language::Program& program = lc.EditProgram();
+	program.sources.push_back(code);
+	char* resolved = realpath(programPath.c_str(), nullptr);
+	if (resolved != nullptr) {
+		program.modules.insert(resolved);
+		free(resolved);
+	}
+
+	// the cache keeps the unchecked and unoptimised program, so --no-opt can
+	// use it too
+	Checker::Check(lc, 0);
+	Bytecode::Optimise(lc, 0);
+
+	if (codeDebug) {
+		Bytecode::Visualise(lc);
 		return;
 	}
 
-	Language::LanguageComponents lc;
-	lc.Init(tokens, programPath);
 	lc.JumpToLabel("main");
 
-	Interpret(lc, false);
+	if (maxDepth != 0) {
+		lc.maxDepth = maxDepth;
+	}
+	if (profile) {
+		lc.profiler = std::make_unique <Profiler::Recorder>("main");
+	}
+	if (stats || profile) {
+		reportLc     = &lc;
+		reportStats  = stats;
+		reportThread = std::this_thread::get_id();
+		atexit(Report);
+	}
+
+	Interpret(lc, 0);
+	Report();
 }
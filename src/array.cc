@@ -0,0 +1,316 @@
+#include "builtin.hh"
+
+// the array builtins, they take their arguments from the top of the pass
+// stack and check every index against the array's length
+
+static Language::Array& ArrayArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (value.GetType() != Language::Type::Array) {
+		BuiltIn::ArgumentTypeError(name, n, "array", value.GetType());
+	}
+	return value.Get <Language::Array>();
+}
+
+// count elements from start, compared without adding them so that indices
+// near the top of a word can't wrap around. the error names the first
+// index that's out of range
+static void CheckRange(
+	const char* name, size_t start, size_t count, const Language::Array& array
+) {
+	size_t length = array.Length();
+	if ((start > length) || (count > length - start)) {
+		fprintf(
+			stderr, "[ERROR] %s: Index %llu out of range for array of length %llu\n",
+			name, (unsigned long long int) std::max(start, length),
+			(unsigned long long int) length
+		);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static const char* ElementName(Language::Element element) {
+	switch (element) {
+		case Language::Element::Byte:    return "byte";
+		case Language::Element::Integer: return "integer";
+		case Language::Element::Word:    return "word";
+		case Language::Element::Float:   return "float";
+	}
+	return "err";
+}
+
+static void Store(
+	const char* name, Language::Array& array, size_t index, const Language::Value& value
+) {
+	auto element = array.GetElement();
+	switch (element) {
+		case Language::Element::Byte: {
+			if (value.GetType() != Language::Type::Integer) {
+				break;
+			}
+			if ((value.Get <int32_t>() < 0) || (value.Get <int32_t>() > UINT8_MAX)) {
+				fprintf(
+					stderr, "[ERROR] %s: %i doesn't fit in a byte\n",
+					name, (int) value.Get <int32_t>()
+				);
+				exit(EXIT_FAILURE);
+			}
+			array.Store <uint8_t>(index, (uint8_t) value.Get <int32_t>());
+			return;
+		}
+		case Language::Element::Integer: {
+			if (value.GetType() == Language::Type::Integer) {
+				array.Store <int32_t>(index, value.Get <int32_t>());
+				return;
+			}
+			break;
+		}
+		case Language::Element::Word: {
+			// integer literals can be stored in words, like they can be assigned
+			if (value.GetType() == Language::Type::Word) {
+				array.Store <uint64_t>(index, value.Get <size_t>());
+				return;
+			}
+			if ((value.GetType() == Language::Type::Integer) && (value.Get <int32_t>() >= 0)) {
+				array.Store <uint64_t>(index, (uint64_t) value.Get <int32_t>());
+				return;
+			}
+			break;
+		}
+		case Language::Element::Float: {
+			if (value.GetType() == Language::Type::Float) {
+				array.Store <double>(index, value.Get <double>());
+				return;
+			}
+			break;
+		}
+	}
+	fprintf(
+		stderr, "[ERROR] %s: Can't store %s in %s array\n",
+		name, Language::TypeToString(value.GetType()).c_str(), ElementName(element)
+	);
+	exit(EXIT_FAILURE);
+}
+
+static Language::Value Load(const Language::Array& array, size_t index) {
+	switch (array.GetElement()) {
+		case Language::Element::Byte: {
+			return (int32_t) array.Load <uint8_t>(index);
+		}
+		case Language::Element::Integer: {
+			return array.Load <int32_t>(index);
+		}
+		case Language::Element::Word: {
+			return (size_t) array.Load <uint64_t>(index);
+		}
+		case Language::Element::Float: {
+			return array.Load <double>(index);
+		}
+	}
+	return Language::Value();
+}
+
+void BuiltIn::ArrayNew(Language::LanguageComponents& lc) {
+	const char* name = "ArrayNew";
+	BuiltIn::ExpectArguments(lc, name, 2, "string, integer/word");
+
+	Language::Value& kind = BuiltIn::Argument(lc, 2, 1);
+	if (kind.GetType() != Language::Type::String) {
+		BuiltIn::ArgumentTypeError(name, 1, "string", kind.GetType());
+	}
+	const std::string& kindName = kind.Get <Language::String>().Get();
+	Language::Element  element;
+	if (kindName == "byte")         element = Language::Element::Byte;
+	else if (kindName == "integer") element = Language::Element::Integer;
+	else if (kindName == "word")    element = Language::Element::Word;
+	else if (kindName == "float")   element = Language::Element::Float;
+	else {
+		fprintf(
+			stderr, "[ERROR] %s: Unknown element type %s, expected "
+			"byte/integer/word/float\n", name, kindName.c_str()
+		);
+		exit(EXIT_FAILURE);
+	}
+	size_t length = BuiltIn::IndexArgument(lc, name, 2, 2);
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(Language::Array(element, length));
+}
+
+void BuiltIn::ArrayGet(Language::LanguageComponents& lc) {
+	const char* name = "ArrayGet";
+	BuiltIn::ExpectArguments(lc, name, 2, "array, integer/word");
+
+	Language::Array& array = ArrayArgument(lc, name, 2, 1);
+	size_t           index = BuiltIn::IndexArgument(lc, name, 2, 2);
+	CheckRange(name, index, 1, array);
+
+	Language::Value ret = Load(array, index);
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(ret));
+}
+
+void BuiltIn::ArraySet(Language::LanguageComponents& lc) {
+	const char* name = "ArraySet";
+	BuiltIn::ExpectArguments(lc, name, 3, "array, integer/word, element");
+
+	Language::Array& array = ArrayArgument(lc, name, 3, 1);
+	size_t           index = BuiltIn::IndexArgument(lc, name, 3, 2);
+	CheckRange(name, index, 1, array);
+	Store(name, array, index, BuiltIn::Argument(lc, 3, 3));
+
+	lc.passStack.resize(lc.passStack.size() - 3);
+}
+
+void BuiltIn::ArrayLen(Language::LanguageComponents& lc) {
+	const char* name = "ArrayLen";
+	BuiltIn::ExpectArguments(lc, name, 1, "array");
+
+	int32_t length = (int32_t) ArrayArgument(lc, name, 1, 1).Length();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(length);
+}
+
+void BuiltIn::ArrayFill(Language::LanguageComponents& lc) {
+	const char* name = "ArrayFill";
+	BuiltIn::ExpectArguments(lc, name, 2, "array, element");
+
+	Language::Array& array  = ArrayArgument(lc, name, 2, 1);
+	size_t           length = array.Length();
+	if (length != 0) {
+		// the first element is checked and stored like any other, then copied
+		Store(name, array, 0, BuiltIn::Argument(lc, 2, 2));
+		size_t   size  = Language::ElementSize(array.GetElement());
+		uint8_t* bytes = array.Bytes();
+		if (size == 1) {
+			memset(bytes + 1, bytes[0], length - 1);
+		}
+		else {
+			for (size_t j = 1; j < length; ++j) {
+				memcpy(bytes + j * size, bytes, size);
+			}
+		}
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+}
+
+void BuiltIn::ArrayCopy(Language::LanguageComponents& lc) {
+	const char* name = "ArrayCopy";
+	BuiltIn::ExpectArguments(
+		lc, name, 5, "array, integer/word, array, integer/word, integer/word"
+	);
+
+	Language::Array& to    = ArrayArgument(lc, name, 5, 1);
+	size_t           at    = BuiltIn::IndexArgument(lc, name, 5, 2);
+	Language::Array& from  = ArrayArgument(lc, name, 5, 3);
+	size_t           start = BuiltIn::IndexArgument(lc, name, 5, 4);
+	size_t           count = BuiltIn::IndexArgument(lc, name, 5, 5);
+	if (to.GetElement() != from.GetElement()) {
+		fprintf(
+			stderr, "[ERROR] %s: Can't copy %s array into %s array\n",
+			name, ElementName(from.GetElement()), ElementName(to.GetElement())
+		);
+		exit(EXIT_FAILURE);
+	}
+	if (count != 0) {
+		CheckRange(name, at, count, to);
+		CheckRange(name, start, count, from);
+		// the arrays can be the same one
+		size_t size = Language::ElementSize(to.GetElement());
+		memmove(to.Bytes() + at * size, from.Bytes() + start * size, count * size);
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 5);
+}
+
+void BuiltIn::ArraySlice(Language::LanguageComponents& lc) {
+	const char* name = "ArraySlice";
+	BuiltIn::ExpectArguments(lc, name, 3, "array, integer/word, integer/word");
+
+	Language::Array& array = ArrayArgument(lc, name, 3, 1);
+	size_t           start = BuiltIn::IndexArgument(lc, name, 3, 2);
+	size_t           end   = BuiltIn::IndexArgument(lc, name, 3, 3);
+	if (end < start) {
+		fprintf(
+			stderr, "[ERROR] %s: Slice ends at %llu, before it starts at %llu\n",
+			name, (unsigned long long int) end, (unsigned long long int) start
+		);
+		exit(EXIT_FAILURE);
+	}
+	CheckRange(name, start, end - start, array);
+
+	Language::Array slice(array.GetElement(), end - start);
+	size_t          size = Language::ElementSize(array.GetElement());
+	if (end != start) {
+		memcpy(slice.Bytes(), array.Bytes() + start * size, (end - start) * size);
+	}
+	lc.passStack.resize(lc.passStack.size() - 3);
+	lc.returnValues.push_back(std::move(slice));
+}
+
+void BuiltIn::StrToArray(Language::LanguageComponents& lc) {
+	const char* name = "StrToArray";
+	BuiltIn::ExpectArguments(lc, name, 1, "string");
+
+	const std::string& text = BuiltIn::StringArgument(lc, name, 1, 1).Get();
+	Language::Array    array(Language::Element::Byte, text.length());
+	if (!text.empty()) {
+		memcpy(array.Bytes(), text.data(), text.length());
+	}
+
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(std::move(array));
+}
+
+void BuiltIn::ArrayToStr(Language::LanguageComponents& lc) {
+	const char* name = "ArrayToStr";
+	BuiltIn::ExpectArguments(lc, name, 1, "array");
+
+	Language::Array& array = ArrayArgument(lc, name, 1, 1);
+	if (array.GetElement() != Language::Element::Byte) {
+		fprintf(
+			stderr, "[ERROR] %s: Only byte arrays can be made into strings, got %s "
+			"array\n", name, ElementName(array.GetElement())
+		);
+		exit(EXIT_FAILURE);
+	}
+	Language::String str(
+		(array.Length() == 0)? std::string() :
+		std::string((const char*) array.Bytes(), array.Length())
+	);
+
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(std::move(str));
+}
+
+template <typename Writer>
+void BuiltIn::WriteArray(Writer& output, const Language::Array& array) {
+	output.Write("[");
+	for (size_t j = 0; j < array.Length(); ++j) {
+		if (j != 0) {
+			output.Write(", ");
+		}
+		Language::Value element = Load(array, j);
+		switch (element.GetType()) {
+			case Language::Type::Integer: {
+				output.Write(element.Get <int32_t>());
+				break;
+			}
+			case Language::Type::Word: {
+				output.Write((long long int) element.Get <size_t>());
+				break;
+			}
+			case Language::Type::Float: {
+				output.Write(element.Get <double>());
+				break;
+			}
+			default: break;
+		}
+	}
+	output.Write("]");
+}
+
+template void BuiltIn::WriteArray(Output::Buffer&, const Language::Array&);
+template void BuiltIn::WriteArray(Language::Builder&, const Language::Array&);
@@ -0,0 +1,80 @@
+#include "builtin.hh"
+
+// builders and their builtins, numbers are formatted with to_chars straight
+// into the builder's buffer, the same way Output::Buffer formats them
+
+template <typename T, typename... Format>
+static void WriteNumber(std::string& text, size_t most, T value, Format... format) {
+	size_t length = text.length();
+	text.resize(length + most);
+	auto result = std::to_chars(
+		text.data() + length, text.data() + text.length(), value, format...
+	);
+	text.resize(result.ptr - text.data());
+}
+
+void Language::Builder::Write(int32_t value) {
+	WriteNumber(data->text, 16, value);
+}
+
+void Language::Builder::Write(double value) {
+	// same as %g
+	WriteNumber(data->text, 32, value, std::chars_format::general, 6);
+}
+
+void Language::Builder::Write(long long int value) {
+	WriteNumber(data->text, 24, value);
+}
+
+Language::String Language::Builder::Freeze() {
+	Language::String ret(std::move(data->text));
+	data->text.clear();
+	return ret;
+}
+
+static Language::Builder& BuilderArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (value.GetType() != Language::Type::Builder) {
+		BuiltIn::ArgumentTypeError(name, n, "builder", value.GetType());
+	}
+	return value.Get <Language::Builder>();
+}
+
+void BuiltIn::BuilderNew(Language::LanguageComponents& lc) {
+	lc.returnValues.push_back(Language::Builder());
+}
+
+// value is written the way print would write it
+void BuiltIn::BuilderAppend(Language::LanguageComponents& lc) {
+	const char* name = "BuilderAppend";
+	BuiltIn::ExpectArguments(lc, name, 2, "builder, value");
+
+	Language::Builder& builder = BuilderArgument(lc, name, 2, 1);
+	Language::Value&   value   = BuiltIn::Argument(lc, 2, 2);
+	if (!BuiltIn::WriteValue(builder, value)) {
+		BuiltIn::ArgumentTypeError(name, 2, "value", value.GetType());
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+}
+
+void BuiltIn::BuilderLen(Language::LanguageComponents& lc) {
+	const char* name = "BuilderLen";
+	BuiltIn::ExpectArguments(lc, name, 1, "builder");
+
+	int32_t length = (int32_t) BuilderArgument(lc, name, 1, 1).Length();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(length);
+}
+
+// the text is moved into the string, not copied
+void BuiltIn::BuilderFreeze(Language::LanguageComponents& lc) {
+	const char* name = "BuilderFreeze";
+	BuiltIn::ExpectArguments(lc, name, 1, "builder");
+
+	Language::String str = BuilderArgument(lc, name, 1, 1).Freeze();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(std::move(str));
+}
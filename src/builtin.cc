@@ -1,38 +1,139 @@
 #include "builtin.hh"
 #include "lexer.hh"
 #include "fs.hh"
+#include "cache.hh"
 #include "util.hh"
 #include "interpreter.hh"
+#include "checker.hh"
 
-void BuiltIn::Print(Language::LanguageComponents& lc) {
-	for (auto& arg : lc.passStack) {
-		switch (arg.type) {
-			case Language::Type::String: {
-				fputs(std::get <std::string>(arg.value).c_str(), stdout);
-				break;
-			}
-			case Language::Type::Integer: {
-				printf("%i", std::get <int32_t>(arg.value));
-				break;
-			}
-			case Language::Type::Float: {
-				printf("%g", std::get <double>(arg.value));
-				break;
-			}
-			case Language::Type::Bool: {
-				printf("%s", std::get <bool>(arg.value)? "true" : "false");
-				break;
-			}
-			case Language::Type::Word: {
-				printf("%lli", (long long int) std::get <size_t>(arg.value));
-				break;
+void BuiltIn::ExpectArguments(
+	Language::LanguageComponents& lc, const char* name, size_t count, const char* types
+) {
+	if (lc.passStack.size() < count) {
+		fprintf(
+			stderr, "[ERROR] %s: Expected %i arguments (%s)\n", name, (int) count, types
+		);
+		exit(EXIT_FAILURE);
+	}
+}
+
+Language::Value& BuiltIn::Argument(
+	Language::LanguageComponents& lc, size_t count, size_t n
+) {
+	return lc.passStack[lc.passStack.size() - count + n - 1];
+}
+
+void BuiltIn::ArgumentTypeError(
+	const char* name, size_t n, const char* expected, Language::Type got
+) {
+	fprintf(
+		stderr, "[ERROR] %s: Expected %s as argument %i, got %s\n",
+		name, expected, (int) n, Language::TypeToString(got).c_str()
+	);
+	exit(EXIT_FAILURE);
+}
+
+size_t BuiltIn::IndexArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	switch (value.GetType()) {
+		case Language::Type::Integer: {
+			if (value.Get <int32_t>() < 0) {
+				fprintf(
+					stderr, "[ERROR] %s: Negative index %i as argument %i\n",
+					name, (int) value.Get <int32_t>(), (int) n
+				);
+				exit(EXIT_FAILURE);
 			}
-			default: {
-				fputs("[ERR]", stdout);
+			return (size_t) value.Get <int32_t>();
+		}
+		case Language::Type::Word: return value.Get <size_t>();
+		default: {
+			BuiltIn::ArgumentTypeError(name, n, "integer/word", value.GetType());
+		}
+	}
+	return 0;
+}
+
+Language::String& BuiltIn::StringArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (value.GetType() != Language::Type::String) {
+		BuiltIn::ArgumentTypeError(name, n, "string", value.GetType());
+	}
+	return value.Get <Language::String>();
+}
+
+template <typename Writer>
+bool BuiltIn::WriteValue(Writer& output, const Language::Value& value) {
+	switch (value.GetType()) {
+		case Language::Type::String: {
+			output.Write(value.Get <Language::String>().Get());
+			break;
+		}
+		case Language::Type::Integer: {
+			output.Write(value.Get <int32_t>());
+			break;
+		}
+		case Language::Type::Float: {
+			output.Write(value.Get <double>());
+			break;
+		}
+		case Language::Type::Bool: {
+			output.Write(value.Get <bool>()? "true" : "false");
+			break;
+		}
+		case Language::Type::Word: {
+			output.Write((long long int) value.Get <size_t>());
+			break;
+		}
+		case Language::Type::Array: {
+			BuiltIn::WriteArray(output, value.Get <Language::Array>());
+			break;
+		}
+		case Language::Type::Builder: {
+			output.Write(value.Get <Language::Builder>().View());
+			break;
+		}
+		case Language::Type::Map: {
+			// maps can hold themselves, so ones inside a map aren't written out
+			const Language::Map& map = value.Get <Language::Map>();
+			output.Write("{");
+			for (size_t j = 0; j < map.Size(); ++j) {
+				output.Write((j == 0)? "" : ", ");
+				BuiltIn::WriteValue(output, map.KeyAt(j));
+				output.Write(": ");
+				if (map.ValueAt(j).GetType() == Language::Type::Map) {
+					output.Write("{...}");
+				}
+				else {
+					BuiltIn::WriteValue(output, map.ValueAt(j));
+				}
 			}
+			output.Write("}");
+			break;
+		}
+		default: return false;
+	}
+	return true;
+}
+
+template bool BuiltIn::WriteValue(Output::Buffer&, const Language::Value&);
+template bool BuiltIn::WriteValue(Language::Builder&, const Language::Value&);
+
+void BuiltIn::Print(Language::LanguageComponents& lc) {
+	for (auto& arg : lc.passStack) {
+		if (!BuiltIn::WriteValue(lc.output, arg)) {
+			lc.output.Write("[ERR]");
 		}
 	}
-	lc.passStack = {};
+	lc.passStack.clear();
+}
+
+void BuiltIn::Flush(Language::LanguageComponents& lc) {
+	lc.output.Flush();
 }
 
 void BuiltIn::Return(Language::LanguageComponents& lc) {
@@ -40,8 +141,7 @@ void BuiltIn::Return(Language::LanguageComponents& lc) {
 		fprintf(stderr, "[ERROR] return: nowhere to return to\n");
 		exit(EXIT_FAILURE);
 	}
-	lc.i = lc.returnStack.back();
-	lc.returnStack.pop_back();
+	lc.ReturnFromLabel();
 
 	if (!lc.passStack.empty()) {
 		lc.returnValues.push_back(lc.passStack.back());
@@ -50,15 +150,35 @@ void BuiltIn::Return(Language::LanguageComponents& lc) {
 }
 
 void BuiltIn::Exit(Language::LanguageComponents& lc) {
+	lc.output.Flush();
+	// spawned labels that weren't joined finish first, like when the
+	// program ends without exit
+	lc.tasks.clear();
 	if (lc.passStack.empty()) {
 		exit(EXIT_SUCCESS);
 	}
-	Language::Variable exitCode = lc.passStack.back();
-	if (exitCode.type != Language::Type::Integer) {
+	Language::Value exitCode = lc.passStack.back();
+	if (exitCode.GetType() != Language::Type::Integer) {
 		fprintf(stderr, "[ERROR] Can't use non-integer as escape code\n");
 		exit(EXIT_FAILURE);
 	}
-	exit(std::get <int32_t>(exitCode.value));
+	exit(exitCode.Get <int32_t>());
+}
+
+// goto and goto_if can only go to a label. the code ends with an End that
+// the interpreter stops at instead of checking every address, so a word
+// that isn't a label's address mustn't get past here
+static void GotoLabel(
+	Language::LanguageComponents& lc, const char* name, size_t address
+) {
+	if ((address >= lc.program->code.size()) || (lc.program->code[address].op != Bytecode::Opcode::Nop)) {
+		fprintf(
+			stderr, "[ERROR] %s: %llu isn't the address of a label\n",
+			name, (unsigned long long int) address
+		);
+		exit(EXIT_FAILURE);
+	}
+	lc.i = address;
 }
 
 void BuiltIn::Goto(Language::LanguageComponents& lc) {
@@ -67,17 +187,17 @@ void BuiltIn::Goto(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable jumpTo = lc.passStack.back();
+	Language::Value jumpTo = lc.passStack.back();
 	lc.passStack.pop_back();
-	if (jumpTo.type != Language::Type::Word) {
+	if (jumpTo.GetType() != Language::Type::Word) {
 		fprintf(
 			stderr, "[ERROR] Can't goto to index of type %s\n",
-			Language::TypeToString(jumpTo.type).c_str()
+			Language::TypeToString(jumpTo.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
 
-	lc.i = std::get <size_t>(jumpTo.value);
+	GotoLabel(lc, "Goto", jumpTo.Get <size_t>());
 }
 
 void BuiltIn::Sleep(Language::LanguageComponents& lc) {
@@ -86,17 +206,17 @@ void BuiltIn::Sleep(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable sleepTime = lc.passStack.back();
+	Language::Value sleepTime = lc.passStack.back();
 	lc.passStack.pop_back();
 
-	switch (sleepTime.type) {
+	switch (sleepTime.GetType()) {
 		case Language::Type::Integer: {
-			int32_t sleep = std::get <int32_t>(sleepTime.value);
+			int32_t sleep = sleepTime.Get <int32_t>();
 			std::this_thread::sleep_for(std::chrono::seconds(sleep));
 			break;
 		}
 		case Language::Type::Float: {
-			double sleep = std::get <double>(sleepTime.value);
+			double sleep = sleepTime.Get <double>();
 			size_t time = (size_t) round(sleep * 1000000000);
 
 			std::this_thread::sleep_for(std::chrono::nanoseconds(time));
@@ -105,100 +225,159 @@ void BuiltIn::Sleep(Language::LanguageComponents& lc) {
 		default: {
 			fprintf(
 				stderr,"[ERROR] Invalid sleep time type %s\n",
-				Language::TypeToString(sleepTime.type).c_str()
+				Language::TypeToString(sleepTime.GetType()).c_str()
 			);
 			exit(EXIT_FAILURE);
 		}
 	}
 }
 
-void Operation(std::string name, Language::LanguageComponents& lc) {
-	Language::Variable second = lc.passStack.back();
-	lc.passStack.pop_back();
-	Language::Variable first = lc.passStack.back();
-	lc.passStack.pop_back();
-
-	if (first.type != second.type) {
-		fprintf(stderr, "[ERROR] %s: parameters not of the same type\n", name.c_str());
-		exit(EXIT_FAILURE);
+static const char* OperatorName(BuiltIn::Operator op) {
+	switch (op) {
+		case BuiltIn::Operator::Add: return "Add";
+		case BuiltIn::Operator::Sub: return "Sub";
+		case BuiltIn::Operator::Mul: return "Mul";
+		case BuiltIn::Operator::Div: return "Div";
+		case BuiltIn::Operator::Mod: return "Mod";
 	}
-	if (
-		(first.type != Language::Type::Integer) &&
-		(first.type != Language::Type::Word) &&
-		(first.type != Language::Type::Float)
+	return "Err";
+}
+
+template <BuiltIn::Operator op, typename T>
+static void Kernel(Language::Value& first, const Language::Value& second) {
+	T& lhs = first.Get <T>();
+	T  rhs = second.Get <T>();
+
+	if constexpr (
+		std::is_integral_v <T> &&
+		((op == BuiltIn::Operator::Div) || (op == BuiltIn::Operator::Mod))
 	) {
-		fprintf(stderr, "[ERROR] %s: unsupported type in parameters\n", name.c_str());
-		exit(EXIT_FAILURE);
+		if (rhs == 0) {
+			fprintf(stderr, "[ERROR] %s: division by zero\n", OperatorName(op));
+			exit(EXIT_FAILURE);
+		}
 	}
 
-	Language::Variable result;
-	result.type = first.type;
+	// integers wrap around, they're worked out unsigned so that's defined
+	if constexpr (std::is_integral_v <T> && (op == BuiltIn::Operator::Add)) {
+		lhs = (T) ((std::make_unsigned_t <T>) lhs + (std::make_unsigned_t <T>) rhs);
+	}
+	else if constexpr (std::is_integral_v <T> && (op == BuiltIn::Operator::Sub)) {
+		lhs = (T) ((std::make_unsigned_t <T>) lhs - (std::make_unsigned_t <T>) rhs);
+	}
+	else if constexpr (std::is_integral_v <T> && (op == BuiltIn::Operator::Mul)) {
+		lhs = (T) ((std::make_unsigned_t <T>) lhs * (std::make_unsigned_t <T>) rhs);
+	}
+	else if constexpr (op == BuiltIn::Operator::Add) {
+		lhs = lhs + rhs;
+	}
+	else if constexpr (op == BuiltIn::Operator::Sub) {
+		lhs = lhs - rhs;
+	}
+	else if constexpr (op == BuiltIn::Operator::Mul) {
+		lhs = lhs * rhs;
+	}
+	else if constexpr (op == BuiltIn::Operator::Div) {
+		lhs = lhs / rhs;
+	}
+	else if constexpr (std::is_floating_point_v <T>) {
+		lhs = fmod(lhs, rhs);
+	}
+	else {
+		lhs = lhs % rhs;
+	}
+}
 
-	switch (result.type) {
-		case Language::Type::Float: {
-			double firstNum  = std::get <double>(first.value);
-			double secondNum = std::get <double>(second.value);
-			if (name == "Add") {
-				result.value = (double) (firstNum + secondNum);
-			}
-			else if (name == "Sub") {
-				result.value = (double) (firstNum - secondNum);
-			}
-			else if (name == "Mul") {
-				result.value = (double) (firstNum * secondNum);
-			}
-			else if (name == "Div") {
-				result.value = (double) (firstNum / secondNum);
-			}
-			else if (name == "Mod") {
-				result.value = (double) (fmod(firstNum, secondNum));
-			}
-			break;
-		}
-		case Language::Type::Integer: {
-			int32_t firstNum  = std::get <int32_t>(first.value);
-			int32_t secondNum = std::get <int32_t>(second.value);
-			if (name == "Add") {
-				result.value = (int32_t) (firstNum + secondNum);
-			}
-			else if (name == "Sub") {
-				result.value = (int32_t) (firstNum - secondNum);
-			}
-			else if (name == "Mul") {
-				result.value = (int32_t) (firstNum * secondNum);
-			}
-			else if (name == "Div") {
-				result.value = (int32_t) (firstNum / secondNum);
-			}
-			else if (name == "Mod") {
-				result.value = (int32_t) (firstNum % secondNum);
-			}
-			break;
+typedef void (*OperationKernel)(Language::Value&, const Language::Value&);
+
+template <BuiltIn::Operator op>
+static constexpr OperationKernel kernels[] = {
+	Kernel <op, int32_t>,
+	Kernel <op, size_t>,
+	Kernel <op, double>
+};
+
+static const OperationKernel* operationKernels[] = {
+	kernels <BuiltIn::Operator::Add>,
+	kernels <BuiltIn::Operator::Sub>,
+	kernels <BuiltIn::Operator::Mul>,
+	kernels <BuiltIn::Operator::Div>,
+	kernels <BuiltIn::Operator::Mod>
+};
+
+// applies op to first in place, first and second must be the same type
+static void Operate(
+	BuiltIn::Operator op, Language::Value& first, Language::Value& second
+) {
+	if (first.GetType() != second.GetType()) {
+		fprintf(
+			stderr, "[ERROR] %s: parameters not of the same type\n", OperatorName(op)
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t kernel;
+	switch (first.GetType()) {
+		case Language::Type::Integer: kernel = 0; break;
+		case Language::Type::Word:    kernel = 1; break;
+		case Language::Type::Float:   kernel = 2; break;
+		default: {
+			fprintf(
+				stderr, "[ERROR] %s: unsupported type in parameters\n", OperatorName(op)
+			);
+			exit(EXIT_FAILURE);
 		}
-		default: break;
 	}
 
-	lc.returnValues.push_back(result);
+	operationKernels[(size_t) op][kernel](first, second);
+}
+
+template <BuiltIn::Operator op>
+static void Operation(Language::LanguageComponents& lc) {
+	if (lc.passStack.size() < 2) {
+		fprintf(stderr, "[ERROR] %s: expected 2 arguments\n", OperatorName(op));
+		exit(EXIT_FAILURE);
+	}
+	Language::Value& second = lc.passStack.back();
+	Language::Value& first  = lc.passStack[lc.passStack.size() - 2];
+
+	Operate(op, first, second);
+
+	lc.returnValues.push_back(std::move(first));
+	lc.passStack.pop_back();
+	lc.passStack.pop_back();
 }
 
 void BuiltIn::Add(Language::LanguageComponents& lc) {
-	Operation("Add", lc);
+	Operation <BuiltIn::Operator::Add>(lc);
 }
 
 void BuiltIn::Sub(Language::LanguageComponents& lc) {
-	Operation("Sub", lc);
+	Operation <BuiltIn::Operator::Sub>(lc);
 }
 
 void BuiltIn::Mul(Language::LanguageComponents& lc) {
-	Operation("Mul", lc);
+	Operation <BuiltIn::Operator::Mul>(lc);
 }
 
 void BuiltIn::Div(Language::LanguageComponents& lc) {
-	Operation("Div", lc);
+	Operation <BuiltIn::Operator::Div>(lc);
 }
 
 void BuiltIn::Mod(Language::LanguageComponents& lc) {
-	Operation("Mod", lc);
+	Operation <BuiltIn::Operator::Mod>(lc);
+}
+
+void BuiltIn::ModifyVariable(
+	Language::LanguageComponents& lc, BuiltIn::Operator op, size_t slot
+) {
+	if (lc.passStack.empty()) {
+		fprintf(stderr, "[ERROR] %s: expected 2 arguments\n", OperatorName(op));
+		exit(EXIT_FAILURE);
+	}
+
+	Operate(op, lc.GetVariable(slot), lc.passStack.back());
+	lc.passStack.pop_back();
 }
 
 void BuiltIn::Include(Language::LanguageComponents& lc) {
@@ -206,14 +385,14 @@ void BuiltIn::Include(Language::LanguageComponents& lc) {
 		fprintf(stderr, "[ERROR] Include: no file given to include\n");
 		exit(EXIT_FAILURE);
 	}
-	Language::Variable toInclude = lc.passStack.back();
+	Language::Value toInclude = lc.passStack.back();
 	lc.passStack.pop_back();
-	if (toInclude.type != Language::Type::String) {
+	if (toInclude.GetType() != Language::Type::String) {
 		fprintf(stderr, "[ERROR] Include: a string must be passed to include\n");
 		exit(EXIT_FAILURE);
 	}
 
-	std::string fileName = std::get <std::string>(toInclude.value);
+	std::string fileName = toInclude.Get <Language::String>().Get();
 	if (fileName[0] != '/') {
 		fileName = Util::DirName(lc.fileName) + "/" + fileName;
 	}
@@ -221,14 +400,56 @@ void BuiltIn::Include(Language::LanguageComponents& lc) {
 		fileName = "/usr/include/atmo/" + fileName;
 	}
 
-	std::string code = FS::File::Read(fileName);
-	std::vector <Lexer::Token> tokens = Lexer::Lex(code, fileName);
-
-	Language::LanguageComponents newLc;
-	newLc.Init(tokens, fileName);
+	// every file is only loaded once, however it is named
+	char*       resolved = realpath(fileName.c_str(), nullptr);
+	std::string path     = (resolved == nullptr)? fileName : resolved;
+	free(resolved);
+	if (lc.program->modules.count(path) != 0) {
+		return;
+	}
 
-	Interpret(newLc, false);
-	lc.CopyNewLC(newLc);
+	std::vector <Lexer::Token> tokens;
+	bool                       failed = false;
+	auto code = Cache::Tokens(fileName, fileName, tokens, failed);
+	if (code == nullptr) {
+		fprintf(
+			stderr, "[ERROR] Include: couldn't open %s: %s\n",
+			fileName.c_str(), strerror(errno)
+		);
+		exit(EXIT_FAILURE);
+	}
+	if (failed) {
+		exit(EXIT_FAILURE);
+	}
+	Language::Program& program = lc.EditProgram();
+	program.modules.insert(path);
+	program.sources.push_back(code);
+	// an empty module compiles to nothing, there's no code to run
+	if (tokens.empty()) {
+		return;
+	}
+
+	// the module is compiled onto the end of the program, so its labels and
+	// variables go straight into the program's tables, then its top level
+	// code is run like a label call
+	std::string includedFrom = lc.fileName;
+	lc.fileName = fileName;
+	size_t start = lc.program->code.size();
+	lc.returnStack.push_back({lc.i, lc.frame.label});
+	lc.frame = {0, 0, lc.locals.size(), Bytecode::NoAddress};
+	lc.i     = start;
+	Bytecode::Compile(lc, std::move(tokens));
+	Checker::Check(lc, start);
+	Bytecode::Optimise(lc, start);
+	if (lc.profiler != nullptr) {
+		size_t entry = lc.profiler->FindLabel(start);
+		if (entry == Profiler::NoEntry) {
+			entry = lc.profiler->AddLabel(start, fileName);
+		}
+		lc.profiler->Enter(entry);
+	}
+	Interpret(lc, lc.returnStack.size());
+	lc.fileName = includedFrom;
 }
 
 void BuiltIn::GotoIf(Language::LanguageComponents& lc) {
@@ -237,12 +458,12 @@ void BuiltIn::GotoIf(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable jumpTo = lc.passStack.back();
+	Language::Value jumpTo = lc.passStack.back();
 	lc.passStack.pop_back();
-	if (jumpTo.type != Language::Type::Word) {
+	if (jumpTo.GetType() != Language::Type::Word) {
 		fprintf(
 			stderr, "[ERROR] GotoIf: Expected argument of type word, got %s\n",
-			Language::TypeToString(jumpTo.type).c_str()
+			Language::TypeToString(jumpTo.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
@@ -254,96 +475,119 @@ void BuiltIn::GotoIf(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable boolean = lc.returnValues.back();
+	Language::Value boolean = lc.returnValues.back();
 	bool run = false;
-	switch (boolean.type) {
+	switch (boolean.GetType()) {
 		case Language::Type::Integer: {
-			run = std::get <int32_t>(boolean.value) != 0;
+			run = boolean.Get <int32_t>() != 0;
 			break;
 		}
 		case Language::Type::Bool: {
-			run = std::get <bool>(boolean.value);
+			run = boolean.Get <bool>();
 			break;
 		}
 		default: {
 			fprintf(
 				stderr, "[ERROR] GotoIf: Cannot jump based on value of type %s\n",
-				Language::TypeToString(boolean.type).c_str()
+				Language::TypeToString(boolean.GetType()).c_str()
 			);
 			exit(EXIT_FAILURE);
 		}
 	}
 
 	if (run) {
-		lc.i = std::get <size_t>(jumpTo.value);
+		GotoLabel(lc, "GotoIf", jumpTo.Get <size_t>());
 	}
 }
 
 void BuiltIn::IsEqual(Language::LanguageComponents& lc) {
-	Language::Variable second = lc.passStack.back();
+	Language::Value second = lc.passStack.back();
 	lc.passStack.pop_back();
-	Language::Variable first = lc.passStack.back();
+	Language::Value first = lc.passStack.back();
 	lc.passStack.pop_back();
 
-	if (first.type != second.type) {
+	if (first.GetType() != second.GetType()) {
 		fprintf(stderr, "[ERROR] IsEqual: parameters not of the same type\n");
 		exit(EXIT_FAILURE);
 	}
-	if (
-		(first.type != Language::Type::Integer) &&
-		(first.type != Language::Type::Word) &&
-		(first.type != Language::Type::Float) &&
-		(first.type != Language::Type::String)
-	) {
+	if (!BuiltIn::CanCompare(first.GetType())) {
 		fprintf(stderr, "[ERROR] IsEqual: unsupported type in parameters\n");
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable ret;
-	ret.type = Language::Type::Bool;
+	lc.returnValues.push_back(BuiltIn::Equal(first.GetType(), first, second));
+}
+
+bool BuiltIn::CanCompare(Language::Type type) {
+	return
+		(type == Language::Type::Integer) ||
+		(type == Language::Type::Word) ||
+		(type == Language::Type::Float) ||
+		(type == Language::Type::String);
+}
 
-	switch (first.type) {
+// both values are of type, which CanCompare
+bool BuiltIn::Equal(
+	Language::Type type, const Language::Value& first, const Language::Value& second
+) {
+	switch (type) {
 		case Language::Type::Integer: {
-			ret.value =
-				std::get <int32_t>(first.value) == std::get <int32_t>(second.value);
-			break;
+			return first.Get <int32_t>() == second.Get <int32_t>();
 		}
 		case Language::Type::Word: {
-			ret.value =
-				std::get <size_t>(first.value) == std::get <size_t>(second.value);
-			break;
+			return first.Get <size_t>() == second.Get <size_t>();
 		}
 		case Language::Type::Float: {
-			ret.value =
-				std::get <int32_t>(first.value) == std::get <int32_t>(second.value);
-			break;
+			return first.Get <double>() == second.Get <double>();
 		}
 		case Language::Type::String: {
-			ret.value =
-				std::get <std::string>(first.value) ==
-				std::get <std::string>(second.value);
+			return first.Get <Language::String>() == second.Get <Language::String>();
 		}
-		default: break;
+		default: return false;
 	}
+}
 
-	lc.returnValues.push_back(ret);
+// get_char can read the terminating 0 at the end of a string
+// negative integers are rejected before they're made into huge words
+template <typename Index>
+static size_t CharIndex(const char* name, Index index) {
+	if constexpr (std::is_signed <Index>::value) {
+		if (index < 0) {
+			fprintf(stderr, "[ERROR] %s: Negative index %i\n", name, (int) index);
+			exit(EXIT_FAILURE);
+		}
+	}
+	return (size_t) index;
+}
+
+// get_char can read the NUL after the last character, which ends loops over
+// a string, set_char can only write the characters
+static void CheckIndex(const char* name, size_t index, size_t length, bool end) {
+	if ((index > length) || (!end && (index == length))) {
+		fprintf(
+			stderr, "[ERROR] %s: Index %llu out of range for string of length %llu\n",
+			name, (unsigned long long int) index, (unsigned long long int) length
+		);
+		exit(EXIT_FAILURE);
+	}
 }
 
 void BuiltIn::GetChar(Language::LanguageComponents& lc) {
+	const char* name = "GetChar";
 	if (lc.passStack.empty()) {
 		fprintf(stderr, "[ERROR] GetChar: Expected 2 arguments of type string, integer\n");
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable index = lc.passStack.back();
+	Language::Value index = lc.passStack.back();
 	lc.passStack.pop_back();
 	if (
-		(index.type != Language::Type::Word) &&
-		(index.type != Language::Type::Integer)
+		(index.GetType() != Language::Type::Word) &&
+		(index.GetType() != Language::Type::Integer)
 	) {
 		fprintf(
 			stderr, "[ERROR] GetChar: Expected Word as 2nd argument, got %s\n",
-			Language::TypeToString(index.type).c_str()
+			Language::TypeToString(index.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
@@ -353,63 +597,62 @@ void BuiltIn::GetChar(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable str = lc.passStack.back();
+	Language::Value str = lc.passStack.back();
 	lc.passStack.pop_back();
 
-	if (str.type != Language::Type::String) {
+	if (str.GetType() != Language::Type::String) {
 		fprintf(
 			stderr, "[ERROR] Expected String as first argument, got %s\n",
-			Language::TypeToString(str.type).c_str()
+			Language::TypeToString(str.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
 
 	size_t indexValue = 0;
-	switch (index.type) {
+	switch (index.GetType()) {
 		case Language::Type::Integer: {
-			indexValue = (size_t) std::get <int32_t>(index.value);
+			indexValue = CharIndex(name, index.Get <int32_t>());
 			break;
 		}
 		case Language::Type::Word: {
-			indexValue = std::get <size_t>(index.value);
+			indexValue = index.Get <size_t>();
 			break;
 		}
 		default: break;
 	}
 
-	Language::Variable ret;
-	ret.type = Language::Type::String;
-	ret.value = std::string(1, std::get <std::string>(str.value)[indexValue]);
-
-	lc.returnValues.push_back(ret);
+	const std::string& text = str.Get <Language::String>().Get();
+	CheckIndex(name, indexValue, text.length(), true);
+	lc.returnValues.push_back(Language::String(std::string(1, text[indexValue])));
 }
 
 void BuiltIn::SetChar(Language::LanguageComponents& lc) {
+	const char* name = "SetChar";
 	if (lc.passStack.empty()) {
 		fprintf(stderr, "[ERROR] GetChar: Expected 2 arguments of type string, integer\n");
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable newCharVar = lc.passStack.back();
+	Language::Value newCharVar = lc.passStack.back();
 	lc.passStack.pop_back();
-	if (newCharVar.type != Language::Type::String) {
+	if (newCharVar.GetType() != Language::Type::String) {
 		fprintf(
 			stderr, "[ERROR] SetChar: Expected String as 3rd argument, got %s\n",
-			Language::TypeToString(newCharVar.type).c_str()
+			Language::TypeToString(newCharVar.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
-	char newCh = std::get <std::string>(newCharVar.value)[0];
+	char newCh = newCharVar.Get <Language::String>().Get()[0];
 
-	Language::Variable index = lc.passStack.back();
+	Language::Value index = lc.passStack.back();
 	lc.passStack.pop_back();
 	if (
-		(index.type != Language::Type::Word) &&
-		(index.type != Language::Type::Integer)
+		(index.GetType() != Language::Type::Word) &&
+		(index.GetType() != Language::Type::Integer)
 	) {
 		fprintf(
 			stderr, "[ERROR] GetChar: Expected Word as 2nd argument, got %s\n",
-			Language::TypeToString(index.type).c_str()
+			Language::TypeToString(index.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
@@ -419,38 +662,35 @@ void BuiltIn::SetChar(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable str = lc.passStack.back();
+	Language::Value str = std::move(lc.passStack.back());
 	lc.passStack.pop_back();
 
-	if (str.type != Language::Type::String) {
+	if (str.GetType() != Language::Type::String) {
 		fprintf(
 			stderr, "[ERROR] Expected String as first argument, got %s\n",
-			Language::TypeToString(str.type).c_str()
+			Language::TypeToString(str.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
 
 	size_t indexValue = 0;
-	switch (index.type) {
+	switch (index.GetType()) {
 		case Language::Type::Integer: {
-			indexValue = (size_t) std::get <int32_t>(index.value);
+			indexValue = CharIndex(name, index.Get <int32_t>());
 			break;
 		}
 		case Language::Type::Word: {
-			indexValue = std::get <size_t>(index.value);
+			indexValue = index.Get <size_t>();
 			break;
 		}
 		default: break;
 	}
 
-	std::string strValue = std::get <std::string>(str.value);
-	strValue[indexValue] = newCh;
-
-	Language::Variable ret;
-	ret.type = Language::Type::String;
-	ret.value = strValue;
+	// only copies the characters if the string is still shared
+	CheckIndex(name, indexValue, str.Get <Language::String>().Get().length(), false);
+	str.Get <Language::String>().Mutable()[indexValue] = newCh;
 
-	lc.returnValues.push_back(ret);
+	lc.returnValues.push_back(std::move(str));
 }
 
 void BuiltIn::Unpass(Language::LanguageComponents& lc) {
@@ -469,17 +709,14 @@ void BuiltIn::CharToAscii(Language::LanguageComponents& lc) {
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable ch = lc.passStack.back();
+	Language::Value ch = lc.passStack.back();
 	lc.passStack.pop_back();
-	if (ch.type != Language::Type::String) {
+	if (ch.GetType() != Language::Type::String) {
 		fprintf(stderr, "[ERROR] AsciiToChar: Expected 1 argument of type string\n");
 		exit(EXIT_FAILURE);
 	}
 
-	Language::Variable ret;
-	ret.type = Language::Type::Integer;
-	ret.value = (int32_t) std::get <std::string>(ch.value)[0];
-	lc.returnValues.push_back(ret);
+	lc.returnValues.push_back((int32_t) ch.Get <Language::String>().Get()[0]);
 }
 
 void BuiltIn::StrResize(Language::LanguageComponents& lc) {
@@ -487,44 +724,166 @@ void BuiltIn::StrResize(Language::LanguageComponents& lc) {
 		fprintf(stderr, "[ERROR] StrResize: Expected 2 arguments\n");
 		exit(EXIT_FAILURE);
 	}
-	Language::Variable size = lc.passStack.back();
+	Language::Value size = lc.passStack.back();
 	lc.passStack.pop_back();
-	Language::Variable str = lc.passStack.back();
+	Language::Value str = std::move(lc.passStack.back());
 	lc.passStack.pop_back();
 
-	if (str.type != Language::Type::String) {
+	if (str.GetType() != Language::Type::String) {
 		fprintf(
 			stderr, "[ERROR] StrResize: Expected string as 1st arg, got %s\n",
-			Language::TypeToString(str.type).c_str()
+			Language::TypeToString(str.GetType()).c_str()
 		);
 		exit(EXIT_FAILURE);
 	}
 
 	size_t newSize = 0;
-	switch (size.type) {
+	switch (size.GetType()) {
 		case Language::Type::Integer: {
-			newSize = std::get <int32_t>(size.value);
+			newSize = size.Get <int32_t>();
 			break;
 		}
 		case Language::Type::Word: {
-			newSize = std::get <size_t>(size.value);
+			newSize = size.Get <size_t>();
 			break;
 		}
 		default: {
 			fprintf(
 				stderr, "[ERROR] StrResize: Expected integer/word as 2nd arg, got %s\n",
-				Language::TypeToString(size.type).c_str()
+				Language::TypeToString(size.GetType()).c_str()
 			);
 			exit(EXIT_FAILURE);
 		}
 	}
 
-	std::string toResize = std::get <std::string>(str.value);
+	str.Get <Language::String>().Mutable().resize(newSize, ' ');
+
+	lc.returnValues.push_back(std::move(str));
+}
+
+// versions of the builtins for calls whose argument types were proven by the
+// checker, they leave out the type checks
+
+template <BuiltIn::Operator op, typename T>
+static void TypedOperation(Language::LanguageComponents& lc) {
+	Language::Value& second = lc.passStack.back();
+	Language::Value& first  = lc.passStack[lc.passStack.size() - 2];
+
+	Kernel <op, T>(first, second);
+
+	lc.returnValues.push_back(std::move(first));
+	lc.passStack.pop_back();
+	lc.passStack.pop_back();
+}
+
+template <BuiltIn::Operator op>
+static constexpr Language::CXXFunction typedOperations[] = {
+	TypedOperation <op, int32_t>,
+	TypedOperation <op, size_t>,
+	TypedOperation <op, double>
+};
+
+template <typename T>
+static void TypedIsEqual(Language::LanguageComponents& lc) {
+	bool equal =
+		lc.passStack[lc.passStack.size() - 2].Get <T>() ==
+		(lc.passStack.back()).Get <T>();
+	lc.passStack.pop_back();
+	lc.passStack.pop_back();
+
+	lc.returnValues.push_back(equal);
+}
+
+template <typename Index>
+static void TypedGetChar(Language::LanguageComponents& lc) {
+	size_t index = CharIndex("GetChar", (lc.passStack.back()).Get <Index>());
+	const std::string& str =
+		lc.passStack[lc.passStack.size() - 2].Get <Language::String>().Get();
+	CheckIndex("GetChar", index, str.length(), true);
+
+	Language::Value ret = Language::String(std::string(1, str[index]));
+	lc.passStack.pop_back();
+	lc.passStack.pop_back();
+
+	lc.returnValues.push_back(std::move(ret));
+}
+
+template <typename Index>
+static void TypedSetChar(Language::LanguageComponents& lc) {
+	size_t count = lc.passStack.size();
+	char   newCh = lc.passStack[count - 1].Get <Language::String>().Get()[0];
+	size_t index = CharIndex("SetChar", lc.passStack[count - 2].Get <Index>());
+
+	Language::Value str = std::move(lc.passStack[count - 3]);
+	lc.passStack.resize(count - 3);
+
+	CheckIndex("SetChar", index, str.Get <Language::String>().Get().length(), false);
+	str.Get <Language::String>().Mutable()[index] = newCh;
+
+	lc.returnValues.push_back(std::move(str));
+}
+
+template <typename Index>
+static void TypedStrResize(Language::LanguageComponents& lc) {
+	size_t newSize = (size_t) (lc.passStack.back()).Get <Index>();
+	lc.passStack.pop_back();
+	Language::Value str = std::move(lc.passStack.back());
+	lc.passStack.pop_back();
+
+	str.Get <Language::String>().Mutable().resize(newSize, ' ');
+
+	lc.returnValues.push_back(std::move(str));
+}
+
+static size_t ArithmeticIndex(Language::Type type) {
+	switch (type) {
+		case Language::Type::Integer: return 0;
+		case Language::Type::Word:    return 1;
+		case Language::Type::Float:   return 2;
+		default:                      return Bytecode::NoAddress;
+	}
+}
+
+Language::CXXFunction BuiltIn::Specialise(
+	Language::CXXFunction function, const std::vector <Language::Type>& arguments
+) {
+	static const std::pair <Language::CXXFunction, const Language::CXXFunction*>
+	arithmetic[] = {
+		{BuiltIn::Add, typedOperations <BuiltIn::Operator::Add>},
+		{BuiltIn::Sub, typedOperations <BuiltIn::Operator::Sub>},
+		{BuiltIn::Mul, typedOperations <BuiltIn::Operator::Mul>},
+		{BuiltIn::Div, typedOperations <BuiltIn::Operator::Div>},
+		{BuiltIn::Mod, typedOperations <BuiltIn::Operator::Mod>}
+	};
+	for (auto& operation : arithmetic) {
+		if (function == operation.first) {
+			size_t index = ArithmeticIndex(arguments[0]);
+			return (index == Bytecode::NoAddress)? nullptr : operation.second[index];
+		}
+	}
 
-	Language::Variable ret;
-	ret.type = Language::Type::String;
-	toResize.resize(newSize, ' ');
-	ret.value = toResize;
+	if (function == BuiltIn::IsEqual) {
+		switch (arguments[0]) {
+			case Language::Type::Integer: return TypedIsEqual <int32_t>;
+			case Language::Type::Word:    return TypedIsEqual <size_t>;
+			case Language::Type::Float:   return TypedIsEqual <double>;
+			case Language::Type::String:  return TypedIsEqual <Language::String>;
+			default:                      return nullptr;
+		}
+	}
 
-	lc.returnValues.push_back(str);
+	// the rest take a string and an integer or word index
+	if (function == BuiltIn::GetChar) {
+		return (arguments[1] == Language::Type::Integer)?
+			TypedGetChar <int32_t> : TypedGetChar <size_t>;
+	}
+	if (function == BuiltIn::SetChar) {
+		return (arguments[1] == Language::Type::Integer)?
+			TypedSetChar <int32_t> : TypedSetChar <size_t>;
+	}
+	if (function == BuiltIn::StrResize) {
+		return (arguments[1] == Language::Type::Integer)?
+			TypedStrResize <int32_t> : TypedStrResize <size_t>;
+	}
+	return nullptr;
 }
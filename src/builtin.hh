@@ -3,7 +3,45 @@
 #include "language.hh"
 
 namespace BuiltIn {
+	enum class Operator {
+		Add = 0,
+		Sub,
+		Mul,
+		Div,
+		Mod
+	};
+	struct InPlaceOperation {
+		const char* name;
+		Operator    op;
+	};
+	// called as `add_to variable value`, compiled to ModifyVariable
+	constexpr InPlaceOperation inPlaceOperations[] = {
+		{"add_to", Operator::Add},
+		{"sub_to", Operator::Sub},
+		{"mul_to", Operator::Mul},
+		{"div_to", Operator::Div},
+		{"mod_to", Operator::Mod}
+	};
+
+	// for builtins that take count arguments from the top of the pass stack,
+	// which are numbered from 1. they report errors for the builtin name
+	void ExpectArguments(
+		Language::LanguageComponents& lc, const char* name, size_t count, const char* types
+	);
+	Language::Value&  Argument(Language::LanguageComponents& lc, size_t count, size_t n);
+	[[noreturn]] void ArgumentTypeError(
+		const char* name, size_t n, const char* expected, Language::Type got
+	);
+	// an integer that isn't negative, or a word
+	size_t IndexArgument(
+		Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+	);
+	Language::String& StringArgument(
+		Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+	);
+
 	void Print(Language::LanguageComponents& lc);
+	void Flush(Language::LanguageComponents& lc);
 	void Return(Language::LanguageComponents& lc);
 	void Exit(Language::LanguageComponents& lc);
 	void Goto(Language::LanguageComponents& lc);
@@ -21,4 +59,64 @@ namespace BuiltIn {
 	void Unpass(Language::LanguageComponents& lc);
 	void CharToAscii(Language::LanguageComponents& lc);
 	void StrResize(Language::LanguageComponents& lc);
+	// array.cc
+	void ArrayNew(Language::LanguageComponents& lc);
+	void ArrayGet(Language::LanguageComponents& lc);
+	void ArraySet(Language::LanguageComponents& lc);
+	void ArrayLen(Language::LanguageComponents& lc);
+	void ArrayFill(Language::LanguageComponents& lc);
+	void ArrayCopy(Language::LanguageComponents& lc);
+	void ArraySlice(Language::LanguageComponents& lc);
+	void StrToArray(Language::LanguageComponents& lc);
+	void ArrayToStr(Language::LanguageComponents& lc);
+	// Writer is Output::Buffer or Language::Builder
+	template <typename Writer>
+	void WriteArray(Writer& output, const Language::Array& array);
+	// strings.cc
+	void StrLen(Language::LanguageComponents& lc);
+	void StrFind(Language::LanguageComponents& lc);
+	void StrCount(Language::LanguageComponents& lc);
+	void StrCompare(Language::LanguageComponents& lc);
+	void StrStartsWith(Language::LanguageComponents& lc);
+	void StrEndsWith(Language::LanguageComponents& lc);
+	void StrUpper(Language::LanguageComponents& lc);
+	void StrLower(Language::LanguageComponents& lc);
+	// builder.cc
+	void BuilderNew(Language::LanguageComponents& lc);
+	void BuilderAppend(Language::LanguageComponents& lc);
+	void BuilderLen(Language::LanguageComponents& lc);
+	void BuilderFreeze(Language::LanguageComponents& lc);
+	// io.cc
+	void FileOpen(Language::LanguageComponents& lc);
+	void FileReadLine(Language::LanguageComponents& lc);
+	void FileRead(Language::LanguageComponents& lc);
+	void FileAtEnd(Language::LanguageComponents& lc);
+	void FileWrite(Language::LanguageComponents& lc);
+	void FileClose(Language::LanguageComponents& lc);
+	// map.cc
+	void MapNew(Language::LanguageComponents& lc);
+	void MapSet(Language::LanguageComponents& lc);
+	void MapGet(Language::LanguageComponents& lc);
+	void MapHas(Language::LanguageComponents& lc);
+	void MapDelete(Language::LanguageComponents& lc);
+	void MapSize(Language::LanguageComponents& lc);
+	void MapKeyAt(Language::LanguageComponents& lc);
+	void MapValueAt(Language::LanguageComponents& lc);
+	// tasks.cc
+	void Spawn(Language::LanguageComponents& lc);
+	void Join(Language::LanguageComponents& lc);
+	// the way print writes value, nothing is written for a deleted variable
+	template <typename Writer>
+	bool WriteValue(Writer& output, const Language::Value& value);
+
+	void ModifyVariable(Language::LanguageComponents& lc, Operator op, size_t slot);
+	bool CanCompare(Language::Type type);
+	// for calls the checker proved the argument types of, nullptr if there
+	// is no version of function that leaves out the type checks
+	Language::CXXFunction Specialise(
+		Language::CXXFunction function, const std::vector <Language::Type>& arguments
+	);
+	bool Equal(
+		Language::Type type, const Language::Value& first, const Language::Value& second
+	);
 }
@@ -0,0 +1,594 @@
+#include "bytecode.hh"
+#include "language.hh"
+#include "builtin.hh"
+
+struct Fixup {
+	size_t      instruction;
+	std::string key;
+	std::string name;
+};
+
+static std::string LabelKey(std::string scope, std::string_view name) {
+	// sub-labels are local to the label they are declared under
+	if (name[0] == ':') {
+		return scope + std::string(name);
+	}
+	return std::string(name);
+}
+
+static void UnexpectedToken(
+	Language::LanguageComponents& lc, Lexer::Token& token, const char* code
+) {
+	fprintf(
+		stderr, "[ERROR] (%s) Unexpected token %s at %s:%i:%i\n",
+		code,
+		Lexer::TypeAsString(token).c_str(),
+		lc.fileName.c_str(),
+		(int) token.line, (int) token.column
+	);
+	exit(EXIT_FAILURE);
+}
+
+static bool IsLiteral(Lexer::TokenType type) {
+	switch (type) {
+		case Lexer::TokenType::String:
+		case Lexer::TokenType::Integer:
+		case Lexer::TokenType::Float:
+		case Lexer::TokenType::Bool: {
+			return true;
+		}
+		default: return false;
+	}
+}
+
+class Compiler {
+	public:
+		Language::LanguageComponents&    lc;
+		Language::Program&               program;
+		size_t                           tokenBase;
+		std::string                      scope;
+		std::unordered_set <std::string> labelNames;
+		std::unordered_set <std::string> variableNames;
+		// variables declared in each label, they are local to its calls
+		std::unordered_map <std::string, std::vector <std::string>> localNames;
+		std::unordered_map <std::string, Language::Frame>           frames;
+		std::vector <Fixup>              fixups;
+		// labels of the file being compiled, they take precedence over labels
+		// with the same name from other modules
+		std::unordered_map <std::string, size_t> ownLabels;
+
+		Compiler(Language::LanguageComponents& p_lc, size_t p_tokenBase):
+			lc(p_lc), program(p_lc.EditProgram()), tokenBase(p_tokenBase) {}
+
+		Lexer::Token& Token(size_t t) {
+			return program.tokens[t];
+		}
+
+		void Emit(Bytecode::Opcode op, size_t operand, size_t variable, size_t token) {
+			program.code.push_back({op, operand, variable, token, nullptr});
+		}
+
+		size_t Local(const std::string& name) {
+			auto frame = frames.find(scope);
+			if (frame == frames.end()) {
+				return Bytecode::NoAddress;
+			}
+			for (size_t j = 0; j < frame->second.size; ++j) {
+				if (program.localNames[frame->second.first + j] == name) {
+					return Bytecode::LocalSlot | (frame->second.first + j);
+				}
+			}
+			return Bytecode::NoAddress;
+		}
+
+		size_t Slot(size_t token) {
+			std::string name  = std::string(Token(token).content);
+			size_t      local = Local(name);
+			return (local != Bytecode::NoAddress)? local : lc.VariableSlot(name);
+		}
+
+		bool IsLabel(std::string_view view) {
+			std::string name = std::string(view);
+			std::string key  = LabelKey(scope, name);
+			return
+				(labelNames.count(key) != 0) || (labelNames.count(name) != 0) ||
+				(program.labels.count(key) != 0)  || (program.labels.count(name) != 0);
+		}
+
+		bool IsVariable(std::string_view view) {
+			std::string name = std::string(view);
+			if ((variableNames.count(name) != 0) || (Local(name) != Bytecode::NoAddress)) {
+				return true;
+			}
+			auto slot = program.variableSlots.find(name);
+			return (slot != program.variableSlots.end()) && lc.VariableExists(slot->second);
+		}
+
+		void EmitBuiltin(Bytecode::Opcode op, size_t builtin, size_t token) {
+			Emit(op, builtin, Bytecode::NoAddress, token);
+			program.code.back().function = lc.functions[builtin].function;
+			++ program.boundCalls;
+		}
+
+		void EmitLabelReference(Bytecode::Opcode op, size_t variable, size_t token) {
+			std::string name = std::string(Token(token).content);
+			fixups.push_back({program.code.size(), LabelKey(scope, name), name});
+			Emit(op, Bytecode::NoAddress, variable, token);
+		}
+
+		size_t BuiltinIndex(std::string_view name) {
+			for (size_t j = 0; j < lc.functions.size(); ++j) {
+				if (lc.functions[j].name == name) {
+					return j;
+				}
+			}
+			return Bytecode::NoAddress;
+		}
+
+		void Argument(size_t t) {
+			if (IsLiteral(Token(t).type)) {
+				Emit(Bytecode::Opcode::PushLiteral, 0, Bytecode::NoAddress, t);
+			}
+			else if (Token(t).type == Lexer::TokenType::Identifier) {
+				if (IsLabel(Token(t).content)) {
+					EmitLabelReference(Bytecode::Opcode::PushIdentifier, Slot(t), t);
+				}
+				else {
+					Emit(
+						Bytecode::Opcode::PushIdentifier, Bytecode::NoAddress, Slot(t), t
+					);
+				}
+			}
+			else {
+				UnexpectedToken(lc, Token(t), "2");
+			}
+		}
+
+		// compiles `add_to variable value` and friends, which update the
+		// variable in place instead of returning a new value
+		size_t InPlaceCall(size_t t, BuiltIn::Operator op) {
+			if (
+				(Token(t + 1).type != Lexer::TokenType::Identifier) ||
+				(Token(t + 2).type == Lexer::TokenType::End) ||
+				(Token(t + 3).type != Lexer::TokenType::End)
+			) {
+				fprintf(
+					stderr, "[ERROR] %s: expected a variable and a value at %s:%i:%i\n",
+					std::string(Token(t).content).c_str(),
+					lc.fileName.c_str(),
+					(int) Token(t).line, (int) Token(t).column
+				);
+				exit(EXIT_FAILURE);
+			}
+
+			Argument(t + 2);
+			Emit(Bytecode::Opcode::ModifyVariable, (size_t) op, Slot(t + 1), t);
+			return t + 3;
+		}
+
+		// compiles a function call starting at token t, returns the index of
+		// the End token that finishes it
+		size_t Call(size_t t) {
+			for (auto& operation : BuiltIn::inPlaceOperations) {
+				if (Token(t).content == operation.name) {
+					return InPlaceCall(t, operation.op);
+				}
+			}
+
+			size_t j = t + 1;
+			for (; Token(j).type != Lexer::TokenType::End; ++j) {
+				Argument(j);
+			}
+
+			std::string_view name    = Token(t).content;
+			size_t           builtin = BuiltinIndex(name);
+			if (name == "return") {
+				EmitBuiltin(Bytecode::Opcode::Return, builtin, t);
+			}
+			else if (builtin != Bytecode::NoAddress) {
+				EmitBuiltin(Bytecode::Opcode::CallBuiltin, builtin, t);
+			}
+			else if (IsLabel(name)) {
+				EmitLabelReference(Bytecode::Opcode::CallLabel, Bytecode::NoAddress, t);
+			}
+			else {
+				Emit(Bytecode::Opcode::CallName, 0, Bytecode::NoAddress, t);
+			}
+			return j;
+		}
+
+		// in `str = set_char str 0 "a"` the old value of str is overwritten
+		// by the result, so it can be moved into the builtin instead of
+		// copied, which lets the builtin modify the string without copying it
+		void MoveArgument(size_t start, size_t slot) {
+			if (program.code.back().op != Bytecode::Opcode::CallBuiltin) {
+				return;
+			}
+
+			size_t move  = Bytecode::NoAddress;
+			size_t count = 0;
+			for (size_t j = start; j < program.code.size(); ++j) {
+				if (program.code[j].variable == slot) {
+					move = j;
+					++ count;
+				}
+			}
+			if (
+				(count == 1) &&
+				(program.code[move].op == Bytecode::Opcode::PushIdentifier)
+			) {
+				program.code[move].op = Bytecode::Opcode::PushMove;
+			}
+		}
+
+		// compiles the right hand side of an assignment to the variable
+		// named by token lvalue, returns the index of the End token
+		size_t Assignment(size_t lvalue, size_t t) {
+			auto& token = Token(t);
+			if (IsLiteral(token.type)) {
+				Emit(Bytecode::Opcode::AssignLiteral, 0, Slot(lvalue), t);
+				++ t;
+			}
+			else if (token.type == Lexer::TokenType::FunctionOrIdentifier) {
+				bool hasArgs = Token(t + 1).type != Lexer::TokenType::End;
+				if (
+					hasArgs || IsLabel(token.content) ||
+					(BuiltinIndex(token.content) != Bytecode::NoAddress)
+				) {
+					size_t function = t;
+					size_t start    = program.code.size();
+					t = Call(t);
+					MoveArgument(start, Slot(lvalue));
+					Emit(Bytecode::Opcode::AssignReturn, 0, Slot(lvalue), function);
+				}
+				else if (IsVariable(token.content)) {
+					Emit(Bytecode::Opcode::AssignVariable, Slot(t), Slot(lvalue), t);
+					++ t;
+				}
+				else {
+					// either a variable or a label from an include
+					Emit(Bytecode::Opcode::AssignName, Slot(t), Slot(lvalue), t);
+					++ t;
+				}
+			}
+			else {
+				UnexpectedToken(lc, token, "1");
+			}
+
+			if (Token(t).type != Lexer::TokenType::End) {
+				UnexpectedToken(lc, Token(t), "5");
+			}
+			return t;
+		}
+
+		void Statement(size_t& t) {
+			auto& token = Token(t);
+			switch (token.type) {
+				case Lexer::TokenType::Label: {
+					if (token.content[0] != ':') {
+						scope = std::string(token.content);
+					}
+					for (auto& key : {LabelKey(scope, token.content), std::string(token.content)}) {
+						ownLabels.emplace(key, program.code.size());
+						program.labels.emplace(key, program.code.size());
+					}
+					auto frame = frames.find(scope);
+					if (frame == frames.end()) {
+						Emit(Bytecode::Opcode::Nop, 0, Bytecode::NoAddress, t);
+					}
+					else {
+						Emit(Bytecode::Opcode::Nop, frame->second.size, frame->second.first, t);
+					}
+					break;
+				}
+				case Lexer::TokenType::End: {
+					break;
+				}
+				case Lexer::TokenType::FunctionCall: {
+					t = Call(t);
+					break;
+				}
+				case Lexer::TokenType::Keyword: {
+					if ((token.content == "let") || (token.content == "local")) {
+						if (Token(t + 1).type != Lexer::TokenType::Type) {
+							UnexpectedToken(lc, Token(t + 1), "3");
+						}
+						Language::Type type =
+							Language::StringToType(std::string(Token(t + 1).content));
+						if (type == Language::Type::Err) {
+							fprintf(
+								stderr, "[ERROR] Unknown type %s at %s:%i:%i\n",
+								std::string(Token(t + 1).content).c_str(),
+								lc.fileName.c_str(),
+								(int) Token(t + 1).line, (int) Token(t + 1).column
+							);
+							exit(EXIT_FAILURE);
+						}
+						if (Token(t + 2).type == Lexer::TokenType::End) {
+							UnexpectedToken(lc, Token(t + 2), "3");
+						}
+						if (Token(t + 3).type != Lexer::TokenType::Equals) {
+							fprintf(
+								stderr, "[ERROR] (3) Unexpected token %s at %s:%i:%i\n"
+								"    Unitialised variables are not allowed\n",
+								Lexer::TypeAsString(Token(t + 3)).c_str(),
+								lc.fileName.c_str(),
+								(int) Token(t + 3).line, (int) Token(t + 3).column
+							);
+							exit(EXIT_FAILURE);
+						}
+
+						Emit(Bytecode::Opcode::Let, (size_t) type, Slot(t + 2), t + 2);
+						t = Assignment(t + 2, t + 4);
+					}
+					else if (token.content == "del") {
+						if (Token(t + 1).type != Lexer::TokenType::Identifier) {
+							UnexpectedToken(lc, Token(t + 1), "3");
+						}
+						Emit(Bytecode::Opcode::Del, 0, Slot(t + 1), t + 1);
+						t += 2;
+						if (Token(t).type != Lexer::TokenType::End) {
+							UnexpectedToken(lc, Token(t), "5");
+						}
+					}
+					break;
+				}
+				case Lexer::TokenType::Identifier: {
+					if (Token(t + 1).type != Lexer::TokenType::Equals) {
+						UnexpectedToken(lc, Token(t + 1), "4");
+					}
+					t = Assignment(t, t + 2);
+					break;
+				}
+				default: {
+					UnexpectedToken(lc, token, "5");
+				}
+			}
+		}
+};
+
+void Bytecode::Compile(
+	Language::LanguageComponents& lc, std::vector <Lexer::Token> tokens
+) {
+	if (tokens.empty()) {
+		return;
+	}
+	if (tokens.back().type != Lexer::TokenType::End) {
+		tokens.push_back({Lexer::TokenType::End, "", tokens.back().line, 0});
+	}
+
+	Compiler           compiler(lc, lc.program->tokens.size());
+	Language::Program& program = compiler.program;
+	if (program.tokens.empty()) {
+		program.tokens = std::move(tokens);
+	}
+	else {
+		program.tokens.insert(
+			program.tokens.end(),
+			std::make_move_iterator(tokens.begin()), std::make_move_iterator(tokens.end())
+		);
+	}
+
+	// collect label and variable names first so that references to labels
+	// further down the file can be resolved. variables declared with local
+	// in a label are locals of its calls, everywhere in that label. let, and
+	// local in main or before the first label, declare globals
+	for (size_t t = compiler.tokenBase; t < program.tokens.size(); ++t) {
+		auto& token = program.tokens[t];
+		if (
+			(token.type == Lexer::TokenType::Keyword) &&
+			((token.content == "let") || (token.content == "local"))
+		) {
+			if (t + 2 >= program.tokens.size()) {
+				continue;
+			}
+			std::string name = std::string(program.tokens[t + 2].content);
+			if (
+				(token.content == "let") || compiler.scope.empty() ||
+				(compiler.scope == "main")
+			) {
+				compiler.variableNames.insert(name);
+				continue;
+			}
+			auto& locals = compiler.localNames[compiler.scope];
+			if (std::find(locals.begin(), locals.end(), name) == locals.end()) {
+				locals.push_back(name);
+			}
+			continue;
+		}
+		if (token.type != Lexer::TokenType::Label) {
+			continue;
+		}
+		if (token.content[0] != ':') {
+			compiler.scope = std::string(token.content);
+		}
+		compiler.labelNames.insert(LabelKey(compiler.scope, token.content));
+		compiler.labelNames.insert(std::string(token.content));
+	}
+
+	for (auto& locals : compiler.localNames) {
+		compiler.frames[locals.first] = {
+			program.localNames.size(), locals.second.size(), 0, Bytecode::NoAddress
+		};
+		for (auto& name : locals.second) {
+			program.localNames.push_back(name);
+			program.localGlobals.push_back(lc.VariableSlot(name));
+		}
+	}
+
+	compiler.scope = "";
+	for (size_t t = compiler.tokenBase; t < program.tokens.size(); ++t) {
+		compiler.Statement(t);
+	}
+	// code compiled later (includes, the REPL) goes after this, don't run
+	// into it when the last label ends
+	compiler.Emit(Bytecode::Opcode::End, 0, Bytecode::NoAddress, program.tokens.size() - 1);
+
+	for (auto& fixup : compiler.fixups) {
+		size_t address = Bytecode::NoAddress;
+		for (auto labels : {&compiler.ownLabels, &program.labels}) {
+			for (auto& name : {fixup.key, fixup.name}) {
+				auto label = labels->find(name);
+				if ((address == Bytecode::NoAddress) && (label != labels->end())) {
+					address = label->second;
+				}
+			}
+		}
+		if (address == Bytecode::NoAddress) {
+			continue;
+		}
+		program.code[fixup.instruction].operand = address;
+		if (program.code[fixup.instruction].op == Bytecode::Opcode::CallLabel) {
+			++ program.boundCalls;
+		}
+	}
+}
+
+bool Bytecode::optimise = true;
+
+// by the builtin it was compiled to call, the checker can bind the call to a
+// version of the builtin for its argument types
+static bool IsBuiltinCall(
+	Language::LanguageComponents& lc, const Bytecode::Instruction& instruction,
+	Language::CXXFunction function
+) {
+	return
+		(instruction.op == Bytecode::Opcode::CallBuiltin) &&
+		(lc.functions[instruction.operand].function == function);
+}
+
+// a push of a literal or a variable
+static bool IsValuePush(const Bytecode::Instruction& instruction) {
+	return
+		(instruction.op == Bytecode::Opcode::PushLiteral) || (
+			(instruction.op == Bytecode::Opcode::PushIdentifier) &&
+			(instruction.operand == Bytecode::NoAddress)
+		);
+}
+
+// a push of a label that was found when compiling
+static bool IsLabelPush(const Bytecode::Instruction& instruction) {
+	return
+		(instruction.op == Bytecode::Opcode::PushIdentifier) &&
+		(instruction.operand != Bytecode::NoAddress);
+}
+
+// fuses common sequences in the code from start onwards, so they don't go
+// through the pass stack and return values. only the first instruction of a
+// sequence is replaced, so no addresses change, and the interpreter can run
+// the original sequence when the fused instruction doesn't apply
+void Bytecode::Optimise(Language::LanguageComponents& lc, size_t start) {
+	if (!Bytecode::optimise) {
+		return;
+	}
+
+	Language::Program& program = lc.EditProgram();
+	auto&              code    = program.code;
+	for (size_t j = start; j < code.size(); ++j) {
+		size_t left = code.size() - j;
+
+		// goto label
+		if (
+			(left >= 2) && IsLabelPush(code[j]) &&
+			IsBuiltinCall(lc, code[j + 1], BuiltIn::Goto)
+		) {
+			code[j].op = Bytecode::Opcode::Jump;
+			++ j;
+			continue;
+		}
+
+		// is_equal a b
+		// goto_if label
+		if (
+			(left >= 5) && IsValuePush(code[j]) && IsValuePush(code[j + 1]) &&
+			IsBuiltinCall(lc, code[j + 2], BuiltIn::IsEqual) &&
+			IsLabelPush(code[j + 3]) &&
+			IsBuiltinCall(lc, code[j + 4], BuiltIn::GotoIf)
+		) {
+			code[j].op      = Bytecode::Opcode::CompareBranch;
+			code[j].operand = code[j + 3].operand;
+			j += 4;
+			continue;
+		}
+
+		// x = add x n
+		// x is moved into the call, see MoveArgument
+		if (
+			(left >= 4) && (code[j].op == Bytecode::Opcode::PushMove) &&
+			(code[j + 1].op == Bytecode::Opcode::PushLiteral) && (
+				IsBuiltinCall(lc, code[j + 2], BuiltIn::Add) ||
+				IsBuiltinCall(lc, code[j + 2], BuiltIn::Sub)
+			) &&
+			(code[j + 3].op == Bytecode::Opcode::AssignReturn) &&
+			(code[j + 3].variable == code[j].variable)
+		) {
+			auto& literal = program.tokens[code[j + 1].token].value;
+			if (Language::ValueType(literal) != Language::Type::Integer) {
+				continue;
+			}
+			int32_t amount = literal.Get <int32_t>();
+			if (IsBuiltinCall(lc, code[j + 2], BuiltIn::Sub)) {
+				if (amount == INT32_MIN) {
+					continue;
+				}
+				amount = -amount;
+			}
+			code[j].op      = Bytecode::Opcode::Increment;
+			code[j].operand = (size_t) (int64_t) amount;
+			j += 3;
+		}
+	}
+}
+
+std::string Bytecode::OpcodeAsString(Bytecode::Opcode op) {
+	switch (op) {
+		case Bytecode::Opcode::Nop:            return "nop";
+		case Bytecode::Opcode::PushLiteral:    return "pushLiteral";
+		case Bytecode::Opcode::PushIdentifier: return "pushIdentifier";
+		case Bytecode::Opcode::PushMove:       return "pushMove";
+		case Bytecode::Opcode::CallBuiltin:    return "callBuiltin";
+		case Bytecode::Opcode::CallLabel:      return "callLabel";
+		case Bytecode::Opcode::CallName:       return "callName";
+		case Bytecode::Opcode::Return:         return "return";
+		case Bytecode::Opcode::Let:            return "let";
+		case Bytecode::Opcode::Del:            return "del";
+		case Bytecode::Opcode::AssignLiteral:  return "assignLiteral";
+		case Bytecode::Opcode::AssignReturn:   return "assignReturn";
+		case Bytecode::Opcode::AssignVariable: return "assignVariable";
+		case Bytecode::Opcode::AssignName:     return "assignName";
+		case Bytecode::Opcode::ModifyVariable: return "modifyVariable";
+		case Bytecode::Opcode::CopyVariable:   return "copyVariable";
+		case Bytecode::Opcode::Jump:           return "jump";
+		case Bytecode::Opcode::CompareBranch:  return "compareBranch";
+		case Bytecode::Opcode::Increment:      return "increment";
+		case Bytecode::Opcode::End:            return "end";
+	}
+	return "error";
+}
+
+void Bytecode::Visualise(Language::LanguageComponents& lc) {
+	const Language::Program& program   = *lc.program;
+	size_t                   callSites = 0;
+	for (size_t j = 0; j < program.code.size(); ++j) {
+		auto& instruction = program.code[j];
+		switch (instruction.op) {
+			case Bytecode::Opcode::CallBuiltin:
+			case Bytecode::Opcode::CallLabel:
+			case Bytecode::Opcode::CallName:
+			case Bytecode::Opcode::Return: {
+				++ callSites;
+				break;
+			}
+			default: break;
+		}
+		auto& token = program.tokens[instruction.token];
+		printf(
+			"%i: %s %lli %lli, %.*s (%i:%i)\n",
+			(int) j, Bytecode::OpcodeAsString(instruction.op).c_str(),
+			(long long int) instruction.operand, (long long int) instruction.variable,
+			(int) token.content.length(), token.content.data(),
+			(int) token.line, (int) token.column
+		);
+	}
+	printf("bound call sites: %i/%i\n", (int) program.boundCalls, (int) callSites);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "_components.hh"
+#include "lexer.hh"
+
+namespace Language {
+	class LanguageComponents;
+	typedef void (*CXXFunction)(LanguageComponents&);
+}
+
+namespace Bytecode {
+	enum class Opcode {
+		Nop = 0,        // label position, operand: locals in the label's frame,
+		                // variable: id of its first local
+		PushLiteral,    // token: literal
+		PushIdentifier, // variable: slot, operand: label address if it names a label
+		PushMove,       // variable: slot, moves the value out of the variable
+		CallBuiltin,    // operand: index into functions, function: bound builtin
+		CallLabel,      // operand: label address
+		CallName,       // token: function name, bound to a label when first called
+		Return,         // the return builtin, leaves the current label call
+		Let,            // variable: slot, operand: variable type
+		Del,            // variable: slot
+		AssignLiteral,  // variable: lvalue slot, token: literal
+		AssignReturn,   // variable: lvalue slot, token: function name
+		AssignVariable, // variable: lvalue slot, operand: rvalue slot
+		AssignName,     // variable: lvalue slot, operand: rvalue slot, token: name
+		ModifyVariable, // variable: slot, operand: BuiltIn::Operator
+		CopyVariable,   // AssignVariable with the types checked when loading
+		// fused instructions, written over the first instruction of the
+		// sequence they replace, the rest of which is left in place
+		Jump,           // `goto label`, operand: label address
+		CompareBranch,  // `is_equal a b`, `goto_if label`, operand: label address
+		Increment,      // `x = add x n`, variable: slot, operand: n (negated for sub)
+		End             // end of a program or module, stops the interpreter
+	};
+	constexpr size_t NoAddress = (size_t) -1;
+	// set in the slot of a variable declared inside a label, the rest of the
+	// slot is the local's id, see LanguageComponents::Variable
+	constexpr size_t LocalSlot = (size_t) 1 << 63;
+	struct Instruction {
+		Opcode                op;
+		size_t                operand;
+		size_t                variable;
+		size_t                token;
+		Language::CXXFunction function;
+	};
+
+	extern bool optimise; // off with --no-opt
+
+	void        Compile(Language::LanguageComponents& lc, std::vector <Lexer::Token> tokens);
+	void        Optimise(Language::LanguageComponents& lc, size_t start);
+	std::string OpcodeAsString(Opcode op);
+	void        Visualise(Language::LanguageComponents& lc);
+}
@@ -0,0 +1,500 @@
+#include "cache.hh"
+#include "builtin.hh"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <atomic>
+
+bool Cache::enabled = true;
+
+static const char magic[8] = {'A', 'T', 'M', 'O', 'C', 0, 0, 0};
+
+// FNV-1a
+static uint64_t Hash(std::string_view data, uint64_t hash = 14695981039346656037ull) {
+	for (char ch : data) {
+		hash ^= (unsigned char) ch;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t BuiltinsHash(Language::LanguageComponents& lc) {
+	uint64_t hash = Hash("");
+	for (auto& function : lc.functions) {
+		hash = Hash(function.name, hash);
+		hash = Hash(" ", hash);
+	}
+	return hash;
+}
+
+static int64_t ModifiedTime(const struct stat& info) {
+	return (int64_t) info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+std::string Cache::CachePath(std::string path) {
+	const char* dir = getenv("ATMO_CACHE_DIR");
+	if ((dir == nullptr) || (*dir == '\0')) {
+		return path + "c";
+	}
+
+	// one flat directory, so name the file after the full source path
+	char*       resolved = realpath(path.c_str(), nullptr);
+	std::string full     = (resolved == nullptr)? path : resolved;
+	free(resolved);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long int) Hash(full));
+	return std::string(dir) + "/" + name + ".atmoc";
+}
+
+// reads a part of the file that is count records long
+class Reader {
+	public:
+		std::string_view data;
+		size_t           offset;
+
+		template <typename T> bool Fits(uint64_t count) {
+			return (count <= data.length()) && (offset + count * sizeof(T) <= data.length());
+		}
+
+		template <typename T> T Next() {
+			T value;
+			memcpy(&value, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return value;
+		}
+};
+
+// checks that the cache belongs to the source and this version, touched is
+// set if the source was modified but still has the same contents
+static bool ReadHeader(
+	std::string_view data, const struct stat& info, std::string path,
+	Cache::Header& header, bool& touched
+) {
+	if (data.length() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (
+		(memcmp(header.magic, magic, sizeof(magic)) != 0) ||
+		(header.version != Cache::version) ||
+		(header.tokenSize != sizeof(Cache::CachedToken)) ||
+		(header.sourceSize != (uint64_t) info.st_size) ||
+		(header.textOffset > data.length()) ||
+		(header.textSize > data.length() - header.textOffset)
+	) {
+		return false;
+	}
+
+	touched = header.mtime != ModifiedTime(info);
+	if (touched) {
+		auto source = FS::File::Load(path);
+		if ((source == nullptr) || (Hash(source->View()) != header.hash)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool ReadText(std::string_view text, Cache::TextRange range, std::string_view& out) {
+	if ((uint64_t) range.offset + range.length > text.length()) {
+		return false;
+	}
+	out = text.substr(range.offset, range.length);
+	return true;
+}
+
+static bool ReadTokens(
+	Reader& reader, const Cache::Header& header, std::vector <Lexer::Token>& tokens
+) {
+	std::string_view text = reader.data.substr(header.textOffset, header.textSize);
+	if (!reader.Fits <Cache::CachedToken>(header.tokenCount)) {
+		return false;
+	}
+
+	tokens.resize(header.tokenCount);
+	for (auto& token : tokens) {
+		auto cached = reader.Next <Cache::CachedToken>();
+		if (cached.type > (uint8_t) Lexer::TokenType::End) {
+			return false;
+		}
+		token.type   = (Lexer::TokenType) cached.type;
+		token.line   = cached.line;
+		token.column = cached.column;
+		if (!ReadText(text, cached.content, token.content)) {
+			return false;
+		}
+		switch ((Language::Type) cached.valueType) {
+			case Language::Type::String: {
+				std::string_view value;
+				if (!ReadText(text, cached.string, value)) {
+					return false;
+				}
+				token.value = Language::String(std::string(value));
+				break;
+			}
+			case Language::Type::Integer: token.value = cached.integer;       break;
+			case Language::Type::Float:   token.value = cached.number;        break;
+			case Language::Type::Bool:    token.value = cached.boolean;       break;
+			case Language::Type::Word:    token.value = (size_t) cached.word; break;
+			default:                      break;
+		}
+	}
+	return true;
+}
+
+// a label's address, where its Nop is
+static bool ValidTarget(const std::vector <Bytecode::Instruction>& code, size_t address) {
+	return (address < code.size()) && (code[address].op == Bytecode::Opcode::Nop);
+}
+
+// the interpreter trusts the code, so a stale or corrupt cache mustn't get
+// anything out of range past here
+static bool ValidInstruction(
+	const Cache::Header& header, const std::vector <Bytecode::Instruction>& code,
+	const Bytecode::Instruction& instruction
+) {
+	switch (instruction.op) {
+		case Bytecode::Opcode::PushIdentifier: {
+			return
+				(instruction.variable < header.variableCount) && (
+					(instruction.operand == Bytecode::NoAddress) ||
+					ValidTarget(code, instruction.operand)
+				);
+		}
+		case Bytecode::Opcode::CallLabel: {
+			return ValidTarget(code, instruction.operand);
+		}
+		case Bytecode::Opcode::Let: {
+			return
+				(instruction.variable < header.variableCount) &&
+				(instruction.operand < (size_t) Language::Type::Err);
+		}
+		case Bytecode::Opcode::AssignVariable:
+		case Bytecode::Opcode::AssignName: {
+			return
+				(instruction.variable < header.variableCount) &&
+				(instruction.operand < header.variableCount);
+		}
+		case Bytecode::Opcode::ModifyVariable: {
+			return
+				(instruction.variable < header.variableCount) &&
+				(instruction.operand < sizeof(BuiltIn::inPlaceOperations) /
+				 sizeof(BuiltIn::inPlaceOperations[0]));
+		}
+		case Bytecode::Opcode::PushMove:
+		case Bytecode::Opcode::Del:
+		case Bytecode::Opcode::AssignLiteral:
+		case Bytecode::Opcode::AssignReturn: {
+			return instruction.variable < header.variableCount;
+		}
+		// the cache holds the program before it's optimised
+		case Bytecode::Opcode::Jump:
+		case Bytecode::Opcode::CompareBranch:
+		case Bytecode::Opcode::Increment: {
+			return false;
+		}
+		default: {
+			return true;
+		}
+	}
+}
+
+static bool ReadProgram(
+	Reader& reader, const Cache::Header& header, Language::LanguageComponents& lc
+) {
+	std::string_view text = reader.data.substr(header.textOffset, header.textSize);
+	if (
+		(header.codeCount == 0) || (header.builtins != BuiltinsHash(lc)) ||
+		!reader.Fits <Cache::CachedInstruction>(header.codeCount)
+	) {
+		return false;
+	}
+
+	Language::Program& program = lc.EditProgram();
+	program.code.resize(header.codeCount);
+	for (auto& instruction : program.code) {
+		auto cached = reader.Next <Cache::CachedInstruction>();
+		if (cached.op > (uint64_t) Bytecode::Opcode::End) {
+			return false;
+		}
+		instruction.op       = (Bytecode::Opcode) cached.op;
+		instruction.operand  = cached.operand;
+		instruction.variable = cached.variable;
+		instruction.token    = cached.token;
+		instruction.function = nullptr;
+		if (instruction.token >= header.tokenCount) {
+			return false;
+		}
+		if (
+			(instruction.op == Bytecode::Opcode::CallBuiltin) ||
+			(instruction.op == Bytecode::Opcode::Return)
+		) {
+			if (instruction.operand >= lc.functions.size()) {
+				return false;
+			}
+			instruction.function = lc.functions[instruction.operand].function;
+		}
+	}
+	// the interpreter stops at the End, so it can't run off the code
+	if (program.code.back().op != Bytecode::Opcode::End) {
+		return false;
+	}
+	for (auto& instruction : program.code) {
+		if (!ValidInstruction(header, program.code, instruction)) {
+			return false;
+		}
+	}
+
+	if (!reader.Fits <Cache::CachedLabel>(header.labelCount)) {
+		return false;
+	}
+	for (size_t j = 0; j < header.labelCount; ++j) {
+		auto             cached = reader.Next <Cache::CachedLabel>();
+		std::string_view name;
+		if (!ReadText(text, cached.name, name) || !ValidTarget(program.code, cached.address)) {
+			return false;
+		}
+		program.labels.emplace(std::string(name), cached.address);
+	}
+
+	// slots are handed out in order, so they come out the same
+	if (!reader.Fits <Cache::TextRange>(header.variableCount)) {
+		return false;
+	}
+	for (size_t j = 0; j < header.variableCount; ++j) {
+		std::string_view name;
+		if (!ReadText(text, reader.Next <Cache::TextRange>(), name)) {
+			return false;
+		}
+		lc.VariableSlot(std::string(name));
+	}
+	if (!reader.Fits <Cache::TextRange>(header.localCount)) {
+		return false;
+	}
+	for (size_t j = 0; j < header.localCount; ++j) {
+		std::string_view name;
+		if (!ReadText(text, reader.Next <Cache::TextRange>(), name)) {
+			return false;
+		}
+		program.localNames.push_back(std::string(name));
+		program.localGlobals.push_back(lc.VariableSlot(std::string(name)));
+	}
+	program.boundCalls = header.boundCalls;
+	return true;
+}
+
+// lc is the compiled program, if there is one
+static void Write(
+	std::string cachePath, std::string_view source, const struct stat& info,
+	const std::vector <Lexer::Token>& tokens, Language::LanguageComponents* lc
+) {
+	Cache::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version    = Cache::version;
+	header.tokenSize  = sizeof(Cache::CachedToken);
+	header.sourceSize = source.length();
+	header.mtime      = ModifiedTime(info);
+	header.hash       = Hash(source);
+	header.tokenCount = tokens.size();
+
+	// names repeat a lot, so every distinct piece of text is stored once
+	std::string                                        records;
+	std::string                                        text;
+	std::unordered_map <std::string, Cache::TextRange> pieces;
+	auto addText = [&](std::string_view piece) {
+		auto it = pieces.find(std::string(piece));
+		if (it != pieces.end()) {
+			return it->second;
+		}
+		Cache::TextRange range = {(uint32_t) text.length(), (uint32_t) piece.length()};
+		text += piece;
+		pieces.emplace(std::string(piece), range);
+		return range;
+	};
+	auto addRecord = [&](const auto& record) {
+		records.append((const char*) &record, sizeof(record));
+	};
+
+	for (auto& token : tokens) {
+		Cache::CachedToken cached;
+		memset(&cached, 0, sizeof(cached));
+		cached.type    = (uint8_t) token.type;
+		cached.line    = (uint32_t) token.line;
+		cached.column  = (uint32_t) token.column;
+		cached.content = addText(token.content);
+
+		// tokens that aren't literals hold an empty string
+		bool literal =
+			(token.type == Lexer::TokenType::String) ||
+			(token.type == Lexer::TokenType::Integer) ||
+			(token.type == Lexer::TokenType::Float) ||
+			(token.type == Lexer::TokenType::Bool);
+		cached.valueType = (uint8_t)
+			(literal? Language::ValueType(token.value) : Language::Type::Err);
+		switch ((Language::Type) cached.valueType) {
+			case Language::Type::String: {
+				cached.string = addText(token.value.Get <Language::String>().Get());
+				break;
+			}
+			case Language::Type::Integer: {
+				cached.integer = token.value.Get <int32_t>();
+				break;
+			}
+			case Language::Type::Float: {
+				cached.number = token.value.Get <double>();
+				break;
+			}
+			case Language::Type::Bool: {
+				cached.boolean = token.value.Get <bool>();
+				break;
+			}
+			case Language::Type::Word: {
+				cached.word = token.value.Get <size_t>();
+				break;
+			}
+			default: break;
+		}
+		addRecord(cached);
+	}
+
+	if (lc != nullptr) {
+		header.builtins      = BuiltinsHash(*lc);
+		header.codeCount     = lc->program->code.size();
+		header.labelCount    = lc->program->labels.size();
+		header.variableCount = lc->variables.size();
+		header.localCount    = lc->program->localNames.size();
+		header.boundCalls    = lc->program->boundCalls;
+		for (auto& instruction : lc->program->code) {
+			addRecord(Cache::CachedInstruction {
+				(uint64_t) instruction.op, instruction.operand,
+				instruction.variable, instruction.token
+			});
+		}
+		for (auto& label : lc->program->labels) {
+			addRecord(Cache::CachedLabel {addText(label.first), label.second});
+		}
+		for (auto& name : lc->program->variableNames) {
+			addRecord(addText(name));
+		}
+		for (auto& name : lc->program->localNames) {
+			addRecord(addText(name));
+		}
+	}
+	header.textOffset = sizeof(header) + records.length();
+	header.textSize   = text.length();
+
+	// written to a temporary file first so nothing ever maps half a cache,
+	// named by the process and a count since tasks can include at once
+	static std::atomic <uint64_t> written(0);
+	std::string temporary = cachePath + ".tmp" + std::to_string(getpid()) + "." +
+		std::to_string(written ++);
+	int         fd        = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return; // the cache is optional, read-only directories just don't get one
+	}
+	bool ok = true;
+	for (auto part : {
+		std::string_view((const char*) &header, sizeof(header)),
+		std::string_view(records), std::string_view(text)
+	}) {
+		while (ok && !part.empty()) {
+			ssize_t written = write(fd, part.data(), part.length());
+			if (written <= 0) {
+				ok = errno == EINTR;
+				continue;
+			}
+			part.remove_prefix((size_t) written);
+		}
+	}
+	close(fd);
+	if (!ok || (rename(temporary.c_str(), cachePath.c_str()) != 0)) {
+		unlink(temporary.c_str());
+	}
+}
+
+// loads the tokens, and the compiled program when lc is given, from the
+// cache or from source, and updates the cache if it was missing or stale
+static std::shared_ptr <FS::File::Source> Load(
+	std::string path, std::string fname, std::vector <Lexer::Token>& tokens,
+	Language::LanguageComponents* lc, bool& failed
+) {
+	// files that didn't lex are never cached
+	failed = false;
+
+	// offsets in the cache are 32 bit
+	struct stat info;
+	bool        useCache =
+		Cache::enabled && (stat(path.c_str(), &info) == 0) && S_ISREG(info.st_mode) &&
+		(info.st_size <= (off_t) UINT32_MAX / 2);
+	std::string cachePath = useCache? Cache::CachePath(path) : "";
+
+	auto          cache   = useCache? FS::File::Load(cachePath) : nullptr;
+	Cache::Header header;
+	bool          touched = false;
+	if (
+		(cache != nullptr) && ReadHeader(cache->View(), info, path, header, touched)
+	) {
+		Reader reader = {cache->View(), sizeof(header)};
+		if (ReadTokens(reader, header, tokens)) {
+			bool update = touched;
+			if (lc != nullptr) {
+				if (ReadProgram(reader, header, *lc)) {
+					lc->EditProgram().tokens = std::move(tokens);
+					lc->i                    = 0;
+					lc->fileName             = path;
+				}
+				else {
+					// the cache only had the tokens, compile them and save the
+					// compiled program too
+					lc->program = std::make_shared <Language::Program>();
+					lc->variables.clear();
+					lc->Init(std::move(tokens), path);
+					update = true;
+				}
+			}
+			if (update) {
+				auto source = FS::File::Load(path);
+				if (source != nullptr) {
+					Write(
+						cachePath, source->View(), info,
+						(lc == nullptr)? tokens : lc->program->tokens, lc
+					);
+				}
+			}
+			return cache;
+		}
+		tokens.clear();
+	}
+
+	auto source = FS::File::Load(path);
+	if (source == nullptr) {
+		return nullptr;
+	}
+	tokens = Lexer::Lex(source->View(), fname, &failed);
+	if (tokens.empty()) {
+		return source;
+	}
+	if (lc != nullptr) {
+		lc->Init(std::move(tokens), path);
+	}
+	if (useCache) {
+		Write(cachePath, source->View(), info, (lc == nullptr)? tokens : lc->program->tokens, lc);
+	}
+	return source;
+}
+
+std::shared_ptr <FS::File::Source> Cache::Tokens(
+	std::string path, std::string fname, std::vector <Lexer::Token>& tokens,
+	bool& failed
+) {
+	return Load(path, fname, tokens, nullptr, failed);
+}
+
+std::shared_ptr <FS::File::Source> Cache::Program(
+	std::string path, std::string fname, Language::LanguageComponents& lc,
+	bool& failed
+) {
+	std::vector <Lexer::Token> tokens;
+	return Load(path, fname, tokens, &lc, failed);
+}
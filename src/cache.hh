@@ -0,0 +1,79 @@
+#pragma once
+#include "_components.hh"
+#include "fs.hh"
+#include "lexer.hh"
+#include "language.hh"
+
+// lexed and compiled programs are saved as .atmoc files, next to the
+// source or in $ATMO_CACHE_DIR, and mapped back in on later runs
+namespace Cache {
+	constexpr uint32_t version = 4;
+
+	struct TextRange {
+		uint32_t offset;
+		uint32_t length;
+	};
+	// the file is the header, the tokens, the compiled program if there is
+	// one, then the text everything points into
+	struct Header {
+		char     magic[8];
+		uint32_t version;
+		uint32_t tokenSize;
+		uint64_t sourceSize;
+		int64_t  mtime; // nanoseconds
+		uint64_t hash;
+		uint64_t builtins; // hash of the builtin names, code refers to them by index
+		uint64_t tokenCount;
+		uint64_t codeCount;
+		uint64_t labelCount;
+		uint64_t variableCount;
+		uint64_t localCount;
+		uint64_t boundCalls;
+		uint64_t textOffset;
+		uint64_t textSize;
+	};
+	struct CachedToken {
+		uint8_t   type;
+		uint8_t   valueType;
+		uint16_t  unused;
+		uint32_t  line;
+		uint32_t  column;
+		TextRange content;
+		union {
+			int32_t   integer;
+			double    number;
+			bool      boolean;
+			uint64_t  word;
+			TextRange string;
+		};
+	};
+	struct CachedInstruction {
+		uint64_t op;
+		uint64_t operand;
+		uint64_t variable;
+		uint64_t token;
+	};
+	struct CachedLabel {
+		TextRange name;
+		uint64_t  address;
+	};
+	// variables are stored by slot, then locals by id
+
+	extern bool enabled;
+
+	std::string CachePath(std::string path);
+	// the tokens of the file at path, from the cache if it is up to date and
+	// lexed otherwise, returns what they point into, nullptr if the file
+	// can't be read. failed is set if the lexer found errors, then there are
+	// no tokens
+	std::shared_ptr <FS::File::Source> Tokens(
+		std::string path, std::string fname, std::vector <Lexer::Token>& tokens,
+		bool& failed
+	);
+	// same as Tokens, but also compiles the program into lc, which has to be
+	// empty, or loads the compiled program from the cache
+	std::shared_ptr <FS::File::Source> Program(
+		std::string path, std::string fname, Language::LanguageComponents& lc,
+		bool& failed
+	);
+}
@@ -0,0 +1,408 @@
+#include "checker.hh"
+#include "builtin.hh"
+
+typedef uint32_t TypeSet;
+
+static constexpr TypeSet TypeBit(Language::Type type) {
+	return 1 << (uint32_t) type;
+}
+
+static constexpr TypeSet stringType  = TypeBit(Language::Type::String);
+static constexpr TypeSet wordType    = TypeBit(Language::Type::Word);
+static constexpr TypeSet intType     = TypeBit(Language::Type::Integer);
+static constexpr TypeSet arrayType   = TypeBit(Language::Type::Array);
+static constexpr TypeSet builderType = TypeBit(Language::Type::Builder);
+static constexpr TypeSet fileType    = TypeBit(Language::Type::File);
+static constexpr TypeSet mapType     = TypeBit(Language::Type::Map);
+static constexpr TypeSet anyType     = TypeBit(Language::Type::Err) - 1;
+static constexpr TypeSet indexType   = intType | wordType;
+static constexpr TypeSet sleepType   = intType | TypeBit(Language::Type::Float);
+static constexpr TypeSet numberType  = indexType | sleepType;
+static constexpr TypeSet equalType   = numberType | stringType;
+static constexpr TypeSet keyType     = indexType | stringType;
+
+enum class Result {
+	Nothing,
+	First, // the type of the first argument
+	Bool,
+	Integer,
+	String,
+	Array,
+	Builder,
+	File,
+	Map,
+	Unknown
+};
+
+// what the checker knows about a builtin
+struct Signature {
+	Language::CXXFunction function;
+	size_t                arguments; // taken from the top of the pass stack
+	TypeSet               types[5];
+	bool                  sameTypes;
+	Result                result;
+};
+
+static const Signature signatures[] = {
+	{BuiltIn::Add,         2, {numberType, numberType}, true, Result::First},
+	{BuiltIn::Sub,         2, {numberType, numberType}, true, Result::First},
+	{BuiltIn::Mul,         2, {numberType, numberType}, true, Result::First},
+	{BuiltIn::Div,         2, {numberType, numberType}, true, Result::First},
+	{BuiltIn::Mod,         2, {numberType, numberType}, true, Result::First},
+	{BuiltIn::IsEqual,     2, {equalType,  equalType},  true, Result::Bool},
+	{BuiltIn::GetChar,     2, {stringType, indexType},  false, Result::String},
+	{BuiltIn::SetChar,     3, {stringType, indexType, stringType}, false, Result::String},
+	{BuiltIn::StrResize,   2, {stringType, indexType},  false, Result::String},
+	{BuiltIn::CharToAscii, 1, {stringType},             false, Result::Integer},
+	{BuiltIn::Goto,        1, {wordType},               false, Result::Nothing},
+	{BuiltIn::GotoIf,      1, {wordType},               false, Result::Nothing},
+	{BuiltIn::Include,     1, {stringType},             false, Result::Nothing},
+	{BuiltIn::Sleep,       1, {sleepType},              false, Result::Nothing},
+	{BuiltIn::Exit,        1, {intType},                false, Result::Nothing},
+	{BuiltIn::ArrayNew,    2, {stringType, indexType},  false, Result::Array},
+	{BuiltIn::ArrayGet,    2, {arrayType, indexType},   false, Result::Unknown},
+	{BuiltIn::ArraySet,    3, {arrayType, indexType, numberType}, false, Result::Nothing},
+	{BuiltIn::ArrayLen,    1, {arrayType},              false, Result::Integer},
+	{BuiltIn::ArrayFill,   2, {arrayType, numberType},  false, Result::Nothing},
+	{BuiltIn::ArrayCopy,   5, {arrayType, indexType, arrayType, indexType, indexType},
+		false, Result::Nothing},
+	{BuiltIn::ArraySlice,  3, {arrayType, indexType, indexType}, false, Result::Array},
+	{BuiltIn::StrToArray,  1, {stringType},             false, Result::Array},
+	{BuiltIn::ArrayToStr,  1, {arrayType},              false, Result::String},
+	{BuiltIn::StrLen,        1, {stringType},             false, Result::Integer},
+	{BuiltIn::StrFind,       2, {stringType, stringType}, false, Result::Integer},
+	{BuiltIn::StrCount,      2, {stringType, stringType}, false, Result::Integer},
+	{BuiltIn::StrCompare,    2, {stringType, stringType}, false, Result::Integer},
+	{BuiltIn::StrStartsWith, 2, {stringType, stringType}, false, Result::Bool},
+	{BuiltIn::StrEndsWith,   2, {stringType, stringType}, false, Result::Bool},
+	{BuiltIn::StrUpper,      1, {stringType},             false, Result::String},
+	{BuiltIn::StrLower,      1, {stringType},             false, Result::String},
+	{BuiltIn::BuilderNew,    0, {},                       false, Result::Builder},
+	{BuiltIn::BuilderAppend, 2, {builderType, anyType},   false, Result::Nothing},
+	{BuiltIn::BuilderLen,    1, {builderType},            false, Result::Integer},
+	{BuiltIn::BuilderFreeze, 1, {builderType},            false, Result::String},
+	{BuiltIn::FileOpen,      2, {stringType, stringType}, false, Result::File},
+	{BuiltIn::FileReadLine,  2, {fileType, stringType},   false, Result::String},
+	{BuiltIn::FileRead,      2, {fileType, arrayType},    false, Result::Integer},
+	{BuiltIn::FileAtEnd,     1, {fileType},               false, Result::Bool},
+	{BuiltIn::FileWrite,     2, {fileType, anyType},      false, Result::Nothing},
+	{BuiltIn::FileClose,     1, {fileType},               false, Result::Nothing},
+	{BuiltIn::MapNew,        0, {},                       false, Result::Map},
+	{BuiltIn::MapSet,        3, {mapType, keyType, anyType}, false, Result::Nothing},
+	{BuiltIn::MapGet,        2, {mapType, keyType},       false, Result::Unknown},
+	{BuiltIn::MapHas,        2, {mapType, keyType},       false, Result::Bool},
+	{BuiltIn::MapDelete,     2, {mapType, keyType},       false, Result::Nothing},
+	{BuiltIn::MapSize,       1, {mapType},                false, Result::Integer},
+	{BuiltIn::MapKeyAt,      2, {mapType, indexType},     false, Result::Unknown},
+	{BuiltIn::MapValueAt,    2, {mapType, indexType},     false, Result::Unknown},
+	{BuiltIn::Join,          1, {wordType},               false, Result::Unknown}
+};
+
+static std::string TypeSetToString(TypeSet types) {
+	std::string ret;
+	for (size_t type = 0; type < (size_t) Language::Type::Err; ++type) {
+		if ((types & TypeBit((Language::Type) type)) == 0) {
+			continue;
+		}
+		if (!ret.empty()) {
+			ret += "/";
+		}
+		ret += Language::TypeToString((Language::Type) type);
+	}
+	return ret;
+}
+
+struct Push {
+	Language::Type type; // Err if not known
+	size_t         token;
+};
+
+class TypeChecker {
+	public:
+		Language::LanguageComponents& lc;
+		size_t                        errors;
+		// types of the variables known to exist, Err once deleted
+		std::unordered_map <size_t, Language::Type> variables;
+		// arguments pushed since the last call
+		std::vector <Push>            pushes;
+		// type of the last return value, Err if not known
+		Language::Type                returned;
+
+		TypeChecker(Language::LanguageComponents& p_lc):
+			lc(p_lc), errors(0), returned(Language::Type::Err) {}
+
+		void Forget() {
+			variables.clear();
+			pushes.clear();
+			returned = Language::Type::Err;
+		}
+
+		Language::Type VariableType(size_t slot) {
+			auto variable = variables.find(slot);
+			return (variable == variables.end())? Language::Type::Err : variable->second;
+		}
+
+		std::string VariableName(size_t slot) {
+			return lc.VariableName(slot);
+		}
+
+		void Error(size_t token, const std::string& message) {
+			auto& at = lc.program->tokens[token];
+			fprintf(
+				stderr, "[ERROR] Type error at %s:%i:%i: %s\n",
+				lc.fileName.c_str(), (int) at.line, (int) at.column, message.c_str()
+			);
+			++ errors;
+		}
+
+		void PushIdentifier(Bytecode::Instruction& instruction) {
+			Language::Type type = VariableType(instruction.variable);
+			// a label, unless a variable of the same name exists
+			if (
+				(instruction.operand != Bytecode::NoAddress) &&
+				(variables.count(instruction.variable) != 0) &&
+				(type == Language::Type::Err)
+			) {
+				type = Language::Type::Word;
+			}
+			pushes.push_back({type, instruction.token});
+		}
+
+		void CallBuiltin(Bytecode::Instruction& instruction) {
+			const Signature* signature = nullptr;
+			for (auto& builtin : signatures) {
+				if (builtin.function == lc.functions[instruction.operand].function) {
+					signature = &builtin;
+				}
+			}
+			if (signature == nullptr) {
+				returned = Language::Type::Err;
+				pushes.clear();
+				return;
+			}
+
+			std::string name   = lc.functions[instruction.operand].name;
+			bool        proven = pushes.size() >= signature->arguments;
+			std::vector <Language::Type> types;
+			if (proven) {
+				size_t first = pushes.size() - signature->arguments;
+				for (size_t j = 0; j < signature->arguments; ++j) {
+					auto& push = pushes[first + j];
+					types.push_back(push.type);
+					if (push.type == Language::Type::Err) {
+						proven = false;
+					}
+					else if ((signature->types[j] & TypeBit(push.type)) == 0) {
+						Error(
+							push.token,
+							name + " expects " + TypeSetToString(signature->types[j]) +
+							" as argument " + std::to_string(j + 1) + ", got " +
+							Language::TypeToString(push.type)
+						);
+						proven = false;
+					}
+				}
+				if (
+					proven && signature->sameTypes && (types[0] != types[1])
+				) {
+					Error(
+						instruction.token,
+						name + " arguments are different types, " +
+						Language::TypeToString(types[0]) + " and " +
+						Language::TypeToString(types[1])
+					);
+					proven = false;
+				}
+			}
+
+			if (signature->function == BuiltIn::GotoIf) {
+				if (
+					(returned != Language::Type::Err) &&
+					(returned != Language::Type::Bool) &&
+					(returned != Language::Type::Integer)
+				) {
+					Error(
+						instruction.token,
+						"goto_if can't jump based on a value of type " +
+						Language::TypeToString(returned)
+					);
+				}
+				returned = Language::Type::Err;
+			}
+			else {
+				switch (signature->result) {
+					case Result::Nothing: break;
+					case Result::First: {
+						returned = proven? types[0] : Language::Type::Err;
+						break;
+					}
+					case Result::Bool:    returned = Language::Type::Bool;    break;
+					case Result::Integer: returned = Language::Type::Integer; break;
+					case Result::String:  returned = Language::Type::String;  break;
+					case Result::Array:   returned = Language::Type::Array;   break;
+					case Result::Builder: returned = Language::Type::Builder; break;
+					case Result::File:    returned = Language::Type::File;    break;
+					case Result::Map:     returned = Language::Type::Map;     break;
+					case Result::Unknown: returned = Language::Type::Err;     break;
+				}
+			}
+
+			if (proven && Bytecode::optimise) {
+				Language::CXXFunction typed = BuiltIn::Specialise(signature->function, types);
+				if (typed != nullptr) {
+					instruction.function = typed;
+				}
+			}
+
+			pushes.clear();
+			// include runs code, goto and exit don't carry on
+			if (
+				(signature->function == BuiltIn::Include) ||
+				(signature->function == BuiltIn::Goto) ||
+				(signature->function == BuiltIn::Exit)
+			) {
+				Forget();
+			}
+		}
+
+		void ModifyVariable(Bytecode::Instruction& instruction) {
+			std::string    name  = BuiltIn::inPlaceOperations[instruction.operand].name;
+			Language::Type type  = VariableType(instruction.variable);
+			Language::Type value =
+				pushes.empty()? Language::Type::Err : pushes.back().type;
+			if ((type != Language::Type::Err) && ((numberType & TypeBit(type)) == 0)) {
+				Error(
+					instruction.token,
+					name + " expects " + TypeSetToString(numberType) + " variable, " +
+					VariableName(instruction.variable) + " is " +
+					Language::TypeToString(type)
+				);
+			}
+			else if (
+				(type != Language::Type::Err) && (value != Language::Type::Err) &&
+				(type != value)
+			) {
+				Error(
+					pushes.back().token,
+					name + " arguments are different types, " +
+					Language::TypeToString(type) + " and " + Language::TypeToString(value)
+				);
+			}
+			pushes.clear();
+		}
+
+		void Assign(
+			Language::Type type, Language::Type value, size_t slot, size_t token
+		) {
+			if (
+				(type == Language::Type::Err) || (value == Language::Type::Err) ||
+				(type == value)
+			) {
+				return;
+			}
+			Error(
+				token,
+				"can't assign " + Language::TypeToString(value) + " to " +
+				Language::TypeToString(type) + " variable " + VariableName(slot)
+			);
+		}
+
+		void Instruction(Bytecode::Instruction& instruction) {
+			switch (instruction.op) {
+				case Bytecode::Opcode::PushLiteral: {
+					pushes.push_back({
+						Language::ValueType(lc.program->tokens[instruction.token].value),
+						instruction.token
+					});
+					break;
+				}
+				case Bytecode::Opcode::PushIdentifier: {
+					PushIdentifier(instruction);
+					break;
+				}
+				case Bytecode::Opcode::PushMove: {
+					pushes.push_back({VariableType(instruction.variable), instruction.token});
+					break;
+				}
+				case Bytecode::Opcode::CallBuiltin: {
+					CallBuiltin(instruction);
+					break;
+				}
+				case Bytecode::Opcode::Let: {
+					// locals can be declared again
+					if (
+						(VariableType(instruction.variable) != Language::Type::Err) &&
+						((instruction.variable & Bytecode::LocalSlot) == 0)
+					) {
+						Error(
+							instruction.token,
+							"declaring variable " + VariableName(instruction.variable) +
+							" that already exists"
+						);
+					}
+					variables[instruction.variable] = (Language::Type) instruction.operand;
+					break;
+				}
+				case Bytecode::Opcode::Del: {
+					variables[instruction.variable] = Language::Type::Err;
+					break;
+				}
+				case Bytecode::Opcode::AssignLiteral: {
+					Language::Type type  = VariableType(instruction.variable);
+					Language::Type value =
+						Language::ValueType(lc.program->tokens[instruction.token].value);
+					// integer literals can be assigned to words
+					if ((type == Language::Type::Word) && (value == Language::Type::Integer)) {
+						break;
+					}
+					Assign(type, value, instruction.variable, instruction.token);
+					break;
+				}
+				case Bytecode::Opcode::AssignReturn: {
+					Assign(
+						VariableType(instruction.variable), returned,
+						instruction.variable, instruction.token
+					);
+					returned = Language::Type::Err;
+					break;
+				}
+				case Bytecode::Opcode::AssignVariable: {
+					Language::Type type  = VariableType(instruction.variable);
+					Language::Type value = VariableType(instruction.operand);
+					Assign(type, value, instruction.variable, instruction.token);
+					if (
+						(type != Language::Type::Err) && (type == value) &&
+						Bytecode::optimise
+					) {
+						instruction.op = Bytecode::Opcode::CopyVariable;
+					}
+					break;
+				}
+				case Bytecode::Opcode::ModifyVariable: {
+					ModifyVariable(instruction);
+					break;
+				}
+				default: {
+					// labels can be jumped to, and calls can change any variable
+					Forget();
+				}
+			}
+		}
+};
+
+void Checker::Check(Language::LanguageComponents& lc, size_t start) {
+	// calls are bound to versions of builtins for the types they're given
+	Language::Program& program = lc.EditProgram();
+	TypeChecker        checker(lc);
+	for (size_t j = start; j < program.code.size(); ++j) {
+		checker.Instruction(program.code[j]);
+	}
+
+	if (checker.errors != 0) {
+		fprintf(
+			stderr, "[ERROR] %i type error%s in %s\n",
+			(int) checker.errors, (checker.errors == 1)? "" : "s", lc.fileName.c_str()
+		);
+		exit(EXIT_FAILURE);
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "_components.hh"
+#include "language.hh"
+
+// checks the types in code before it runs. variables can be deleted and
+// declared again with another type, and labels can be jumped to from
+// anywhere, so types are only followed from one label to the next and are
+// forgotten at every label call
+namespace Checker {
+	// reports every type error in the code from start onwards and exits if
+	// there were any, builtin calls and copies whose types were proven are
+	// swapped for versions that don't check the types again
+	void Check(Language::LanguageComponents& lc, size_t start);
+}
@@ -1,21 +1,248 @@
 #include "fs.hh"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Source
+FS::File::Source::Source(std::string p_text):
+	text(std::move(p_text)),
+	mapped(nullptr),
+	length(0)
+{}
+
+FS::File::Source::Source(void* p_mapped, size_t p_length):
+	mapped(p_mapped),
+	length(p_length)
+{}
+
+FS::File::Source::~Source() {
+	if (mapped != nullptr) {
+		munmap(mapped, length);
+	}
+}
+
+std::string_view FS::File::Source::View() const {
+	if (mapped != nullptr) {
+		return std::string_view((const char*) mapped, length);
+	}
+	return text;
+}
+
+// Reader
+FS::File::Reader::Reader(int p_fd, bool p_owned, bool map):
+	fd(p_fd),
+	owned(p_owned),
+	capacity(0),
+	mapped(nullptr),
+	data(nullptr),
+	start(0),
+	end(0),
+	ended(false)
+{
+	struct stat info;
+	if (
+		map && (fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0)
+	) {
+		size_t length = (size_t) info.st_size;
+		void*  region = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (region != MAP_FAILED) {
+			madvise(region, length, MADV_SEQUENTIAL);
+			// stdin can have been read from before
+			off_t at = lseek(fd, 0, SEEK_CUR);
+			mapped = region;
+			data   = (const char*) region;
+			start  = ((at > 0) && ((size_t) at <= length))? (size_t) at : 0;
+			end    = length;
+			ended  = true;
+			return;
+		}
+	}
+
+	capacity = chunkSize;
+	buffer.reset(new char[capacity]);
+	data = buffer.get();
+}
+
+FS::File::Reader::~Reader() {
+	if (owned) {
+		close(fd);
+	}
+	// whatever wasn't used is left for the next reader of a file that stays
+	// open, which only works when it can seek
+	else if (mapped != nullptr) {
+		lseek(fd, (off_t) start, SEEK_SET);
+	}
+	else {
+		lseek(fd, -(off_t) (end - start), SEEK_CUR);
+	}
+	if (mapped != nullptr) {
+		munmap(mapped, end);
+	}
+}
+
+bool FS::File::Reader::Fill() {
+	if (ended) {
+		return false;
+	}
+
+	// what hasn't been used moves to the front, the buffer only grows for
+	// lines longer than it
+	if (start > 0) {
+		memmove(buffer.get(), buffer.get() + start, end - start);
+		end  -= start;
+		start = 0;
+	}
+	if (end == capacity) {
+		std::unique_ptr <char[]> bigger(new char[capacity * 2]);
+		memcpy(bigger.get(), buffer.get(), end);
+		buffer    = std::move(bigger);
+		capacity *= 2;
+		data      = buffer.get();
+	}
+
+	while (true) {
+		ssize_t got = read(fd, buffer.get() + end, capacity - end);
+		if (got > 0) {
+			end += (size_t) got;
+			return true;
+		}
+		if ((got < 0) && (errno == EINTR)) {
+			continue;
+		}
+		ended = true;
+		return false;
+	}
+}
+
+bool FS::File::Reader::ReadLine(std::string_view& line) {
+	size_t searched = 0;
+	while (true) {
+		const char* newline = (const char*) memchr(
+			data + start + searched, '\n', end - start - searched
+		);
+		if (newline != nullptr) {
+			line  = std::string_view(data + start, newline - (data + start));
+			start = newline + 1 - data;
+			return true;
+		}
+		searched = end - start;
+		if (!Fill()) {
+			break;
+		}
+	}
+
+	// the last line doesn't have to end in a newline
+	if (start == end) {
+		return false;
+	}
+	line  = std::string_view(data + start, end - start);
+	start = end;
+	return true;
+}
+
+size_t FS::File::Reader::Read(char* to, size_t length) {
+	size_t got = 0;
+	while (got < length) {
+		if (start == end) {
+			// big reads go straight to the caller instead of through the buffer
+			if ((mapped == nullptr) && (length - got >= capacity) && !ended) {
+				start = end = 0;
+				ssize_t direct = read(fd, to + got, length - got);
+				if ((direct < 0) && (errno == EINTR)) {
+					continue;
+				}
+				if (direct <= 0) {
+					ended = true;
+					break;
+				}
+				got += (size_t) direct;
+				continue;
+			}
+			if (!Fill()) {
+				break;
+			}
+		}
+		size_t count = std::min(end - start, length - got);
+		memcpy(to + got, data + start, count);
+		start += count;
+		got   += count;
+	}
+	return got;
+}
+
+bool FS::File::Reader::AtEnd() {
+	return (start == end) && !Fill();
+}
 
 // File functions
-std::string FS::File::Read(std::string fname) {
-	std::ifstream fhnd(fname);
-	std::string   ret;
-	std::string   line;
+std::shared_ptr <FS::File::Source> FS::File::Load(std::string fname) {
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
 
-	while (getline(fhnd, line)) {
-		ret += line + '\n';
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return nullptr;
+	}
+	if (S_ISDIR(info.st_mode)) {
+		close(fd);
+		errno = EISDIR;
+		return nullptr;
 	}
-	fhnd.close();
 
-	if (ret.length() > 0) {
-		ret.erase(ret.length() - 1, 1);
+	// empty files, pipes and devices can't be mapped
+	if (S_ISREG(info.st_mode) && (info.st_size > 0)) {
+		size_t length = (size_t) info.st_size;
+		void*  mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) {
+			close(fd);
+			return std::make_shared <Source>(mapped, length);
+		}
 	}
 
-	return ret;
+	std::string text;
+	char        buffer[65536];
+	ssize_t     got;
+	while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+		text.append(buffer, (size_t) got);
+	}
+	close(fd);
+	if (got < 0) {
+		return nullptr;
+	}
+	return std::make_shared <Source>(std::move(text));
+}
+
+std::unique_ptr <FS::File::Reader> FS::File::OpenReader(std::string fname, bool map) {
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	struct stat info;
+	if ((fstat(fd, &info) == 0) && S_ISDIR(info.st_mode)) {
+		close(fd);
+		errno = EISDIR;
+		return nullptr;
+	}
+	return std::make_unique <Reader>(fd, true, map);
+}
+
+int FS::File::OpenWriter(std::string fname, bool append) {
+	return open(
+		fname.c_str(), O_WRONLY | O_CREAT | (append? O_APPEND : O_TRUNC), 0644
+	);
+}
+
+std::string FS::File::Read(std::string fname) {
+	auto source = Load(fname);
+	if (source == nullptr) {
+		return "";
+	}
+	return std::string(source->View());
 }
 
 std::vector <std::string> FS::File::ReadIntoVector(std::string fname) {
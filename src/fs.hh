@@ -3,6 +3,64 @@
 
 namespace FS {
 	namespace File {
+		// the contents of a file, mapped into memory when possible so that the
+		// lexer can read it without a copy
+		class Source {
+			public:
+				Source(std::string p_text);
+				Source(void* p_mapped, size_t p_length);
+				~Source();
+				Source(const Source&)            = delete;
+				Source& operator=(const Source&) = delete;
+
+				std::string_view View() const;
+
+			private:
+				std::string text;
+				void*       mapped;
+				size_t      length;
+		};
+
+		// streams a file in chunks through a buffer that is reused for the
+		// whole file, or maps it into memory all at once. lines and chunks
+		// are handed out as views into the buffer
+		class Reader {
+			public:
+				// fd is closed with the reader if owned. map falls back to reading
+				// when fd isn't a regular file
+				Reader(int p_fd, bool owned, bool map);
+				~Reader();
+				Reader(const Reader&)            = delete;
+				Reader& operator=(const Reader&) = delete;
+
+				// the next line without its newline, valid until the next read,
+				// false at the end of the file
+				bool   ReadLine(std::string_view& line);
+				// up to length bytes, 0 at the end of the file
+				size_t Read(char* to, size_t length);
+				bool   AtEnd();
+
+			private:
+				static constexpr size_t chunkSize = 65536;
+
+				// reads the next chunk in after what hasn't been used yet, false
+				// if there is nothing more to read
+				bool Fill();
+
+				int                      fd;
+				bool                     owned;
+				std::unique_ptr <char[]> buffer;
+				size_t                   capacity;
+				void*                    mapped;
+				const char*              data;
+				size_t                   start; // of what hasn't been used
+				size_t                   end;
+				bool                     ended;
+		};
+
+		std::shared_ptr <Source>  Load(std::string fname); // nullptr on failure
+		std::unique_ptr <Reader>  OpenReader(std::string fname, bool map); // same
+		int                       OpenWriter(std::string fname, bool append); // -1 on failure
 		std::string               Read(std::string fname);
 		std::vector <std::string> ReadIntoVector(std::string fname);
 		bool                      Exists(std::string fname);
@@ -1,115 +1,279 @@
 #include "interpreter.hh"
+#include "builtin.hh"
 
-void Interpret(Language::LanguageComponents& lc, bool exitOnReturn) {
-	for (; lc.i < lc.tokens.size(); ++ lc.i) {
-		auto& token = lc.tokens[lc.i];
-		switch (token.type) {
-			case Lexer::TokenType::Label:
-			case Lexer::TokenType::End: {
-				break;
-			}
-			case Lexer::TokenType::FunctionCall: {
-				bool quit = false;
-				if (exitOnReturn && (token.content == "return")) {
-					quit = true;
-				}
-				lc.FunctionCall();
-				if (quit) {
-					return;
-				}
-				break;
-			}
-			case Lexer::TokenType::Keyword: {
-				if (token.content == "let") {
-					Language::Variable newVar;
-					++ lc.i;
-					Language::Type type =
-						Language::StringToType(lc.tokens[lc.i].content);
-					if (type == Language::Type::Err) {
-						fprintf(
-							stderr, "[ERROR] Unknown type %s at %s:%i:%i\n",
-							lc.tokens[lc.i].content.c_str(),
-							lc.fileName.c_str(),
-							(int) lc.tokens[lc.i].line, (int) lc.tokens[lc.i].column
-						);
-						exit(EXIT_FAILURE);
-					}
-					newVar.type = type;
+// the in-place operations aren't builtin calls, but are profiled like them
+static size_t ProfileModify(Language::LanguageComponents& lc, size_t op) {
+	const BuiltIn::InPlaceOperation* operation = &BuiltIn::inPlaceOperations[op];
+	size_t entry = lc.profiler->FindBuiltin(operation);
+	if (entry == Profiler::NoEntry) {
+		entry = lc.profiler->AddBuiltin(operation, operation->name);
+	}
+	return entry;
+}
 
-					++ lc.i;
-					newVar.name = lc.tokens[lc.i].content;
+// opcodes are dispatched with computed gotos (threaded code) where the
+// compiler supports them, build with DISPATCH=switch for the portable loop
+#if defined(__GNUC__) && !defined(ATMO_SWITCH_DISPATCH)
+	#define THREADED_DISPATCH
+#endif
 
-					if (lc.VariableExists(newVar.name)) {
-						fprintf(
-							stderr,
-							"[ERROR] "
-							"Trying to declare variable that already exists at %s:%i:%i\n",
-							lc.fileName.c_str(),
-							(int) lc.tokens[lc.i].line,
-							(int) lc.tokens[lc.i].column
-						);
-						exit(EXIT_FAILURE);
-					}
+#ifdef THREADED_DISPATCH
+	// labels as values are a GNU extension
+	#pragma GCC diagnostic ignored "-Wpedantic"
 
-					++ lc.i;
-					if (lc.tokens[lc.i].type != Lexer::TokenType::Equals) {
-						fprintf(
-							stderr, "[ERROR] (3) Unexpected token %s at %s:%i:%i\n"
-							"    Unitialised variables are not allowed\n",
-							Lexer::TypeAsString(lc.tokens[lc.i]).c_str(),
-							lc.fileName.c_str(),
-							(int) lc.tokens[lc.i].line, (int) lc.tokens[lc.i].column
-						);
-						exit(EXIT_FAILURE);
-					}
+	// every handler jumps straight to the next one, code always ends with an
+	// End instruction so there is no bounds check
+	#define OPCODE(NAME) Op##NAME:
+	#define DISPATCH() \
+		do { \
+			instruction = lc.program->code[lc.i]; \
+			++ lc.executed; \
+			goto *dispatch[(size_t) instruction.op]; \
+		} while (0)
+	#define NEXT() \
+		do { \
+			++ lc.i; \
+			DISPATCH(); \
+		} while (0)
+#else
+	#define OPCODE(NAME) case Bytecode::Opcode::NAME:
+	#define NEXT() break
+#endif
 
-					++ lc.i;
-					lc.CreateVariable(newVar.type, newVar.name);
-					lc.AssignVariable(newVar.name);
-				}
-				else if (token.content == "del") {
-					++ lc.i;
-					if (lc.tokens[lc.i].type != Lexer::TokenType::Identifier) {
-						fprintf(
-							stderr, "[ERROR] (3) Unexpected token %s at %s:%i:%i\n",
-							Lexer::TypeAsString(lc.tokens[lc.i]).c_str(),
-							lc.fileName.c_str(),
-							(int) lc.tokens[lc.i].line, (int) lc.tokens[lc.i].column
-						);
-						exit(EXIT_FAILURE);
-					}
+// the value a push in a fused sequence would push, nullptr if the push would
+// fail, in which case the sequence has to be run to fail the same way
+static const Language::Value* PushedValue(
+	Language::LanguageComponents& lc, const Bytecode::Instruction& push
+) {
+	if (push.variable == Bytecode::NoAddress) {
+		return &lc.program->tokens[push.token].value;
+	}
+	if (!lc.VariableExists(push.variable)) {
+		return nullptr;
+	}
+	return &lc.Variable(push.variable);
+}
 
-					lc.DeleteVariable(lc.tokens[lc.i].content);
-				}
-				break;
-			}
-			case Lexer::TokenType::Identifier: {
-				Language::Variable var = lc.GetVariable(token.content);
+void Interpret(Language::LanguageComponents& lc, size_t depth) {
+	// copied, a call can include more code and move the instruction vector
+	Bytecode::Instruction instruction;
 
-				++ lc.i;
-				if (lc.tokens[lc.i].type != Lexer::TokenType::Equals) {
-					fprintf(
-						stderr, "[ERROR] (4) Unexpected token %s at %s:%i:%i\n",
-						Lexer::TypeAsString(lc.tokens[lc.i]).c_str(),
-						lc.fileName.c_str(),
-						(int) lc.tokens[lc.i].line, (int) lc.tokens[lc.i].column
-					);
-					exit(EXIT_FAILURE);
-				}
+#ifdef THREADED_DISPATCH
+	// in Opcode order
+	static void* const dispatch[] = {
+		&&OpNop,
+		&&OpPushLiteral,
+		&&OpPushIdentifier,
+		&&OpPushMove,
+		&&OpCallBuiltin,
+		&&OpCallLabel,
+		&&OpCallName,
+		&&OpReturn,
+		&&OpLet,
+		&&OpDel,
+		&&OpAssignLiteral,
+		&&OpAssignReturn,
+		&&OpAssignVariable,
+		&&OpAssignName,
+		&&OpModifyVariable,
+		&&OpCopyVariable,
+		&&OpJump,
+		&&OpCompareBranch,
+		&&OpIncrement,
+		&&OpEnd
+	};
+	static_assert(
+		sizeof(dispatch) / sizeof(dispatch[0]) == (size_t) Bytecode::Opcode::End + 1
+	);
 
-				++ lc.i;
-				lc.AssignVariable(var.name);
-				break;
+	if (lc.i >= lc.program->code.size()) {
+		return;
+	}
+	DISPATCH();
+	{
+#else
+	for (; lc.i < lc.program->code.size(); ++ lc.i) {
+		instruction = lc.program->code[lc.i];
+		++ lc.executed;
+		switch (instruction.op) {
+#endif
+		OPCODE(Nop) {
+			NEXT();
+		}
+		OPCODE(PushLiteral) {
+			lc.PushLiteral(lc.program->tokens[instruction.token]);
+			NEXT();
+		}
+		OPCODE(PushIdentifier) {
+			lc.PushIdentifier(
+				lc.program->tokens[instruction.token], instruction.variable, instruction.operand
+			);
+			NEXT();
+		}
+		OPCODE(PushMove) {
+			lc.PushMove(instruction.variable);
+			NEXT();
+		}
+		OPCODE(CallBuiltin) {
+			if (lc.profiler != nullptr) {
+				lc.profiler->Enter(lc.ProfileBuiltin(instruction.operand));
+				instruction.function(lc);
+				lc.profiler->Leave();
+				NEXT();
 			}
-			default: {
+			instruction.function(lc);
+			NEXT();
+		}
+		OPCODE(CallLabel) {
+			lc.CallLabel(instruction.operand);
+			NEXT();
+		}
+		OPCODE(CallName) {
+			lc.CallName(lc.program->tokens[instruction.token]);
+			NEXT();
+		}
+		OPCODE(Return) {
+			instruction.function(lc);
+			if (lc.returnStack.size() < depth) {
+				return;
+			}
+			NEXT();
+		}
+		OPCODE(Let) {
+			// locals can be declared again, in a loop for example
+			auto& name = lc.program->tokens[instruction.token];
+			if (
+				((instruction.variable & Bytecode::LocalSlot) == 0) &&
+				lc.VariableExists(instruction.variable)
+			) {
 				fprintf(
-					stderr, "[ERROR] (5) Unexpected token %s at %s:%i:%i\n",
-					Lexer::TypeAsString(token).c_str(),
+					stderr,
+					"[ERROR] "
+					"Trying to declare variable that already exists at %s:%i:%i\n",
 					lc.fileName.c_str(),
-					(int) token.line, (int) token.column
+					(int) name.line,
+					(int) name.column
 				);
 				exit(EXIT_FAILURE);
 			}
+
+			lc.CreateVariable((Language::Type) instruction.operand, instruction.variable);
+			NEXT();
+		}
+		OPCODE(Del) {
+			lc.DeleteVariable(instruction.variable);
+			NEXT();
+		}
+		OPCODE(AssignLiteral) {
+			lc.AssignLiteral(instruction.variable, lc.program->tokens[instruction.token]);
+			NEXT();
+		}
+		OPCODE(AssignReturn) {
+			lc.AssignReturn(instruction.variable, lc.program->tokens[instruction.token]);
+			NEXT();
+		}
+		OPCODE(AssignVariable) {
+			lc.AssignVariable(
+				instruction.variable, instruction.operand, lc.program->tokens[instruction.token]
+			);
+			NEXT();
+		}
+		OPCODE(AssignName) {
+			lc.AssignName(
+				instruction.variable, instruction.operand, lc.program->tokens[instruction.token]
+			);
+			NEXT();
+		}
+		OPCODE(ModifyVariable) {
+			if (lc.profiler != nullptr) {
+				lc.profiler->Enter(ProfileModify(lc, instruction.operand));
+				BuiltIn::ModifyVariable(
+					lc, (BuiltIn::Operator) instruction.operand, instruction.variable
+				);
+				lc.profiler->Leave();
+				NEXT();
+			}
+			BuiltIn::ModifyVariable(
+				lc, (BuiltIn::Operator) instruction.operand, instruction.variable
+			);
+			NEXT();
+		}
+		OPCODE(CopyVariable) {
+			lc.Variable(instruction.variable) = lc.Variable(instruction.operand);
+			NEXT();
+		}
+		// fused instructions, when they don't apply (while profiling, or when
+		// the sequence would fail) they run the instruction they replaced and
+		// carry on with the rest of the sequence
+		OPCODE(Jump) {
+			if ((lc.profiler != nullptr) || lc.VariableExists(instruction.variable)) {
+				lc.PushIdentifier(
+					lc.program->tokens[instruction.token], instruction.variable, instruction.operand
+				);
+				NEXT();
+			}
+			lc.i = instruction.operand;
+			NEXT();
+		}
+		OPCODE(CompareBranch) {
+			const Bytecode::Instruction* sequence = &lc.program->code[lc.i];
+			const Language::Value*       first    = PushedValue(lc, instruction);
+			const Language::Value*       second   = PushedValue(lc, sequence[1]);
+			if (
+				(lc.profiler != nullptr) || (first == nullptr) || (second == nullptr) ||
+				(first->GetType() != second->GetType()) ||
+				!BuiltIn::CanCompare(first->GetType()) ||
+				lc.VariableExists(sequence[3].variable)
+			) {
+				if (instruction.variable == Bytecode::NoAddress) {
+					lc.PushLiteral(lc.program->tokens[instruction.token]);
+				}
+				else {
+					lc.PushIdentifier(
+						lc.program->tokens[instruction.token], instruction.variable, Bytecode::NoAddress
+					);
+				}
+				NEXT();
+			}
+
+			// is_equal's result stays behind, goto_if doesn't use it up
+			bool equal = BuiltIn::Equal(first->GetType(), *first, *second);
+			lc.returnValues.push_back(equal);
+
+			if (equal) {
+				lc.i = instruction.operand;
+			}
+			else {
+				lc.i += 4;
+			}
+			NEXT();
+		}
+		OPCODE(Increment) {
+			Language::Value& var = lc.Variable(instruction.variable);
+			if ((lc.profiler != nullptr) || (var.GetType() != Language::Type::Integer)) {
+				lc.PushMove(instruction.variable);
+				NEXT();
+			}
+			// wraps around like add does
+			int32_t& value = var.Get <int32_t>();
+			value = (int32_t) ((uint32_t) value + (uint32_t) instruction.operand);
+			lc.i += 3;
+			NEXT();
+		}
+		OPCODE(End) {
+			// a label that runs off the end of its file returns
+			if (lc.returnStack.empty()) {
+				return;
+			}
+			lc.ReturnFromLabel();
+			if (lc.returnStack.size() < depth) {
+				return;
+			}
+			NEXT();
+		}
+
+#ifndef THREADED_DISPATCH
 		}
+#endif
 	}
 }
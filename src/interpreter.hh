@@ -2,4 +2,6 @@
 #include "_components.hh"
 #include "language.hh"
 
-void Interpret(Language::LanguageComponents& lc, bool exitOnReturn);
+// runs until the end of the code, or until a return leaves the label call
+// that made the call stack depth deep, 0 for the whole program
+void Interpret(Language::LanguageComponents& lc, size_t depth);
@@ -0,0 +1,151 @@
+#include "builtin.hh"
+
+// the file builtins. reads go through an FS::File::Reader, which streams the
+// file through one buffer or maps it, and writes through an Output::Buffer
+// like print's
+
+static Language::File& FileArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (value.GetType() != Language::Type::File) {
+		BuiltIn::ArgumentTypeError(name, n, "file", value.GetType());
+	}
+	return value.Get <Language::File>();
+}
+
+static FS::File::Reader& ReaderArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	FS::File::Reader* reader = FileArgument(lc, name, count, n).Reader();
+	if (reader == nullptr) {
+		fprintf(stderr, "[ERROR] %s: File isn't open for reading\n", name);
+		exit(EXIT_FAILURE);
+	}
+	return *reader;
+}
+
+// mode is read, map, write or append. "-" is stdin for read and map
+void BuiltIn::FileOpen(Language::LanguageComponents& lc) {
+	const char* name = "FileOpen";
+	BuiltIn::ExpectArguments(lc, name, 2, "string, string");
+
+	const std::string& path = BuiltIn::StringArgument(lc, name, 2, 1).Get();
+	const std::string& mode = BuiltIn::StringArgument(lc, name, 2, 2).Get();
+	Language::File     file;
+	if ((mode == "read") || (mode == "map")) {
+		std::unique_ptr <FS::File::Reader> reader;
+		if (path == "-") {
+			reader = std::make_unique <FS::File::Reader>(
+				STDIN_FILENO, false, mode == "map"
+			);
+		}
+		else {
+			reader = FS::File::OpenReader(path, mode == "map");
+		}
+		if (reader != nullptr) {
+			file = Language::File(std::move(reader));
+		}
+	}
+	else if ((mode == "write") || (mode == "append")) {
+		int fd = FS::File::OpenWriter(path, mode == "append");
+		if (fd >= 0) {
+			file = Language::File(std::make_unique <Output::Buffer>(fd, true));
+		}
+	}
+	else {
+		fprintf(
+			stderr, "[ERROR] %s: Unknown mode %s, expected read/map/write/append\n",
+			name, mode.c_str()
+		);
+		exit(EXIT_FAILURE);
+	}
+	if ((file.Reader() == nullptr) && (file.Writer() == nullptr)) {
+		fprintf(
+			stderr, "[ERROR] %s: Failed to open %s: %s\n",
+			name, path.c_str(), strerror(errno)
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(file));
+}
+
+// in `line = file_read_line file line` the old line is moved in and its
+// string is reused, so reading a line doesn't allocate. "" at the end of
+// the file, file_at_end tells it apart from an empty line
+void BuiltIn::FileReadLine(Language::LanguageComponents& lc) {
+	const char* name = "FileReadLine";
+	BuiltIn::ExpectArguments(lc, name, 2, "file, string");
+
+	FS::File::Reader& reader = ReaderArgument(lc, name, 2, 1);
+	BuiltIn::StringArgument(lc, name, 2, 2);
+	std::string_view line; // stays empty at the end of the file
+	reader.ReadLine(line);
+	Language::Value str = std::move(lc.passStack.back());
+	str.Get <Language::String>().Mutable().assign(line);
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(str));
+}
+
+// reads into a byte array, up to its length, and returns how many bytes
+// were read, 0 at the end of the file
+void BuiltIn::FileRead(Language::LanguageComponents& lc) {
+	const char* name = "FileRead";
+	BuiltIn::ExpectArguments(lc, name, 2, "file, array");
+
+	FS::File::Reader& reader = ReaderArgument(lc, name, 2, 1);
+	Language::Value&  value  = BuiltIn::Argument(lc, 2, 2);
+	if (value.GetType() != Language::Type::Array) {
+		BuiltIn::ArgumentTypeError(name, 2, "array", value.GetType());
+	}
+	Language::Array& array = value.Get <Language::Array>();
+	if (array.GetElement() != Language::Element::Byte) {
+		fprintf(stderr, "[ERROR] %s: Files can only be read into byte arrays\n", name);
+		exit(EXIT_FAILURE);
+	}
+	size_t got = 0;
+	if (array.Length() != 0) {
+		got = reader.Read((char*) array.Bytes(), array.Length());
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back((int32_t) got);
+}
+
+void BuiltIn::FileAtEnd(Language::LanguageComponents& lc) {
+	const char* name = "FileAtEnd";
+	BuiltIn::ExpectArguments(lc, name, 1, "file");
+
+	bool ended = ReaderArgument(lc, name, 1, 1).AtEnd();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(ended);
+}
+
+// value is written the way print would write it
+void BuiltIn::FileWrite(Language::LanguageComponents& lc) {
+	const char* name = "FileWrite";
+	BuiltIn::ExpectArguments(lc, name, 2, "file, value");
+
+	Output::Buffer* writer = FileArgument(lc, name, 2, 1).Writer();
+	if (writer == nullptr) {
+		fprintf(stderr, "[ERROR] %s: File isn't open for writing\n", name);
+		exit(EXIT_FAILURE);
+	}
+	Language::Value& value = BuiltIn::Argument(lc, 2, 2);
+	if (!BuiltIn::WriteValue(*writer, value)) {
+		BuiltIn::ArgumentTypeError(name, 2, "value", value.GetType());
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+}
+
+void BuiltIn::FileClose(Language::LanguageComponents& lc) {
+	const char* name = "FileClose";
+	BuiltIn::ExpectArguments(lc, name, 1, "file");
+
+	FileArgument(lc, name, 1, 1).Close();
+	lc.passStack.pop_back();
+}
@@ -8,6 +8,10 @@ Language::Type Language::StringToType(std::string type) {
 	if (type == "float")   return Language::Type::Float;
 	if (type == "bool")    return Language::Type::Bool;
 	if (type == "word")    return Language::Type::Word;
+	if (type == "array")   return Language::Type::Array;
+	if (type == "builder") return Language::Type::Builder;
+	if (type == "file")    return Language::Type::File;
+	if (type == "map")     return Language::Type::Map;
 	return Language::Type::Err;
 }
 
@@ -18,12 +22,22 @@ std::string Language::TypeToString(Language::Type type) {
 		case Language::Type::Float:   return "float";
 		case Language::Type::Bool:    return "bool";
 		case Language::Type::Word:    return "word";
+		case Language::Type::Array:   return "array";
+		case Language::Type::Builder: return "builder";
+		case Language::Type::File:    return "file";
+		case Language::Type::Map:     return "map";
 		default:                      break;
 	}
 	return "err";
 }
 
 Language::LanguageComponents::LanguageComponents() {
+	program    = std::make_shared <Program>();
+	executed   = 0;
+	maxDepth   = 100000;
+	nextTask   = 0;
+	frame      = {0, 0, 0, Bytecode::NoAddress};
+
 	RegisterFunction({"print",         BuiltIn::Print});
 	RegisterFunction({"return",        BuiltIn::Return});
 	RegisterFunction({"exit",          BuiltIn::Exit});
@@ -42,28 +56,69 @@ Language::LanguageComponents::LanguageComponents() {
 	RegisterFunction({"unpass",        BuiltIn::Unpass});
 	RegisterFunction({"char_to_ascii", BuiltIn::CharToAscii});
 	RegisterFunction({"str_resize",    BuiltIn::StrResize});
+	RegisterFunction({"flush",         BuiltIn::Flush});
+	RegisterFunction({"array_new",     BuiltIn::ArrayNew});
+	RegisterFunction({"array_get",     BuiltIn::ArrayGet});
+	RegisterFunction({"array_set",     BuiltIn::ArraySet});
+	RegisterFunction({"array_len",     BuiltIn::ArrayLen});
+	RegisterFunction({"array_fill",    BuiltIn::ArrayFill});
+	RegisterFunction({"array_copy",    BuiltIn::ArrayCopy});
+	RegisterFunction({"array_slice",   BuiltIn::ArraySlice});
+	RegisterFunction({"str_to_array",  BuiltIn::StrToArray});
+	RegisterFunction({"array_to_str",  BuiltIn::ArrayToStr});
+	RegisterFunction({"str_len",         BuiltIn::StrLen});
+	RegisterFunction({"str_find",        BuiltIn::StrFind});
+	RegisterFunction({"str_count",       BuiltIn::StrCount});
+	RegisterFunction({"str_compare",     BuiltIn::StrCompare});
+	RegisterFunction({"str_starts_with", BuiltIn::StrStartsWith});
+	RegisterFunction({"str_ends_with",   BuiltIn::StrEndsWith});
+	RegisterFunction({"str_upper",       BuiltIn::StrUpper});
+	RegisterFunction({"str_lower",       BuiltIn::StrLower});
+	RegisterFunction({"builder_new",    BuiltIn::BuilderNew});
+	RegisterFunction({"builder_append", BuiltIn::BuilderAppend});
+	RegisterFunction({"builder_len",    BuiltIn::BuilderLen});
+	RegisterFunction({"builder_freeze", BuiltIn::BuilderFreeze});
+	RegisterFunction({"file_open",      BuiltIn::FileOpen});
+	RegisterFunction({"file_read_line", BuiltIn::FileReadLine});
+	RegisterFunction({"file_read",      BuiltIn::FileRead});
+	RegisterFunction({"file_at_end",    BuiltIn::FileAtEnd});
+	RegisterFunction({"file_write",     BuiltIn::FileWrite});
+	RegisterFunction({"file_close",     BuiltIn::FileClose});
+	RegisterFunction({"map_new",      BuiltIn::MapNew});
+	RegisterFunction({"map_set",      BuiltIn::MapSet});
+	RegisterFunction({"map_get",      BuiltIn::MapGet});
+	RegisterFunction({"map_has",      BuiltIn::MapHas});
+	RegisterFunction({"map_delete",   BuiltIn::MapDelete});
+	RegisterFunction({"map_size",     BuiltIn::MapSize});
+	RegisterFunction({"map_key_at",   BuiltIn::MapKeyAt});
+	RegisterFunction({"map_value_at", BuiltIn::MapValueAt});
+	RegisterFunction({"spawn", BuiltIn::Spawn});
+	RegisterFunction({"join",  BuiltIn::Join});
 }
 
 void Language::LanguageComponents::Init
 (std::vector <Lexer::Token> p_tokens, std::string p_fileName) {
-	tokens   = p_tokens;
 	i        = 0;
 	fileName = p_fileName;
+	Bytecode::Compile(*this, std::move(p_tokens));
+}
+
+Language::Program& Language::LanguageComponents::EditProgram() {
+	if (OwnProgram() == nullptr) {
+		auto copy    = std::make_shared <Program>(*program);
+		copy->shared = false;
+		program      = std::move(copy);
+	}
+	return *OwnProgram();
+}
 
-	/*tokens.push_back({
-		Lexer::TokenType::FunctionCall,
-		"exit",
-		0, 0
-	});
-	tokens.push_back({
-		Lexer::TokenType::Integer,
-		"0",
-		0, 0
-	});
-	tokens.push_back({
-		Lexer::TokenType::End,
-		"", 0, 0
-	});*/
+Language::Program* Language::LanguageComponents::OwnProgram() {
+	if (program->shared || (program.use_count() != 1)) {
+		return nullptr;
+	}
+	// the program was never const, it's made in EditProgram or the
+	// constructor
+	return const_cast <Program*>(program.get());
 }
 
 void Language::LanguageComponents::RegisterFunction(Function function) {
@@ -71,406 +126,355 @@ void Language::LanguageComponents::RegisterFunction(Function function) {
 }
 
 void Language::LanguageComponents::JumpToLabel(std::string name) {
-	for (size_t j = 0; j < tokens.size(); ++j) {
-		if ((tokens[j].type == Lexer::TokenType::Label) && (tokens[j].content == name)) {
-			i = j;
-			return;
-		}
+	auto label = program->labels.find(name);
+	if (label == program->labels.end()) {
+		fprintf(stderr, "[ERROR] Couldn't jump to label %s\n", name.c_str());
+		exit(EXIT_FAILURE);
 	}
-	fprintf(stderr, "[ERROR] Couldn't jump to label %s\n", name.c_str());
-	exit(EXIT_FAILURE);
+	i = label->second;
 }
 
-Language::Variable Language::LanguageComponents::GetVariable(std::string name) {
-	for (size_t j = 0; j < variables.size(); ++j) {
-		if (variables[j].name == name) {
-			return variables[j];
-		}
+size_t Language::LanguageComponents::VariableSlot(std::string name) {
+	auto slot = program->variableSlots.find(name);
+	if (slot != program->variableSlots.end()) {
+		return slot->second;
 	}
-	fprintf(stderr, "[ERROR] Tried to access undefined variable %s\n", name.c_str());
-	exit(EXIT_FAILURE);
-}
 
-void Language::LanguageComponents::SetVariable(Variable variable) {
-	for (auto& var : variables) {
-		if (var.name == variable.name) {
-			var = variable;
-			return;
-		}
-	}
-	variables.push_back(variable);
+	// slots hold Err until the variable is declared with let
+	Program& edit = EditProgram();
+	variables.emplace_back();
+	edit.variableNames.push_back(name);
+	edit.variableSlots[name] = variables.size() - 1;
+	return variables.size() - 1;
 }
 
-void Language::LanguageComponents::AddVariable(Language::Variable variable) {
-	variables.push_back(variable);
+std::string Language::LanguageComponents::VariableName(size_t slot) {
+	if ((slot & Bytecode::LocalSlot) != 0) {
+		return program->localNames[slot & ~Bytecode::LocalSlot];
+	}
+	return program->variableNames[slot];
 }
 
-void Language::LanguageComponents::DeleteVariable(std::string name) {
-	for (auto i = variables.begin(); i < variables.end(); ++i) {
-		if (i->name == name) {
-			variables.erase(i);
-			return;
-		}
+Language::Value& Language::LanguageComponents::GetVariable(size_t slot) {
+	if (!VariableExists(slot)) {
+		fprintf(
+			stderr, "[ERROR] Tried to access undefined variable %s\n",
+			VariableName(slot).c_str()
+		);
+		exit(EXIT_FAILURE);
 	}
-	fprintf(
-		stderr, "[ERROR] Tried to remove undefined variable %s\n",
-		name.c_str()
-	);
-	exit(EXIT_FAILURE);
+	return Variable(slot);
 }
 
-bool Language::LanguageComponents::VariableExists(std::string name) {
-	for (auto& var : variables) {
-		if (var.name == name) {
-			return true;
-		}
+void Language::LanguageComponents::DeleteVariable(size_t slot) {
+	if (!VariableExists(slot)) {
+		fprintf(
+			stderr, "[ERROR] Tried to remove undefined variable %s\n",
+			VariableName(slot).c_str()
+		);
+		exit(EXIT_FAILURE);
 	}
-	return false;
+	Variable(slot) = Language::Value();
 }
 
 bool Language::LanguageComponents::LabelExists(std::string name) {
-	for (auto& token : tokens) {
-		if ((token.type == Lexer::TokenType::Label) && (token.content == name)) {
-			return true;
-		}
-	}
-	return false;
+	return program->labels.count(name) != 0;
 }
 
 size_t Language::LanguageComponents::GetLabel(std::string name) {
-	size_t j = i;
-	if (name[0] == ':') {
-		// sub-label
-		while (true) {
-			if (
-				(tokens[j].type == Lexer::TokenType::Label) &&
-				(tokens[j].content[0] != ':')
-			) {
-				break;
-			}
-		}
-	}
-	// first try starting at i
-	for (; j < tokens.size(); ++j) {
-		if ((tokens[j].type == Lexer::TokenType::Label) && (tokens[j].content == name)) {
-			return j;
-		}
-	}
-	
-	for (size_t j = 0; j < tokens.size(); ++j) {
-		if ((tokens[j].type == Lexer::TokenType::Label) && (tokens[j].content == name)) {
-			return j;
-		}
+	auto label = program->labels.find(name);
+	if (label == program->labels.end()) {
+		fprintf(stderr, "[ERROR] Tried to get non-existent label %s\n", name.c_str());
+		exit(EXIT_FAILURE);
 	}
-	fprintf(stderr, "[ERROR] Tried to get non-existent label %s\n", name.c_str());
-	exit(EXIT_FAILURE);
+	return label->second;
 }
 
-void Language::LanguageComponents::CreateVariable(Type type, std::string name) {
-	Language::Variable newVar;
-	newVar.name = name;
-	newVar.type = type;
+void Language::LanguageComponents::CreateVariable(Type type, size_t slot) {
+	Language::Value& newVar = Variable(slot);
 	switch (type) {
 		case Language::Type::String: {
-			newVar.value = std::string("");
+			newVar = Language::String();
 			break;
 		}
 		case Language::Type::Integer: {
-			newVar.value = (int32_t) 0;
+			newVar = (int32_t) 0;
 			break;
 		}
 		case Language::Type::Float: {
-			newVar.value = (double) 0.0;
+			newVar = (double) 0.0;
 			break;
 		}
 		case Language::Type::Bool: {
-			newVar.value = (bool) false;
+			newVar = (bool) false;
 			break;
 		}
 		case Language::Type::Word: {
-			newVar.value = (size_t) 0;
+			newVar = (size_t) 0;
+			break;
+		}
+		case Language::Type::Array: {
+			newVar = Language::Array();
+			break;
+		}
+		case Language::Type::Builder: {
+			newVar = Language::Builder();
+			break;
+		}
+		case Language::Type::File: {
+			newVar = Language::File();
+			break;
+		}
+		case Language::Type::Map: {
+			newVar = Language::Map();
 			break;
 		}
 		default: {
 			break;
 		}
 	}
-	variables.push_back(newVar);
 }
 
-void Language::LanguageComponents::CallCXXFunction(std::string name) {
-	for (auto& func : functions) {
-		if (func.name == name) {
-			func.function(*this);
-			return;
-		}
-	}
-	fprintf(stderr, "[ERROR] Tried to call undefined funtcion %s\n", name.c_str());
+static void TypeError(std::string fileName, const Lexer::Token& token) {
+	fprintf(
+		stderr,
+		"[ERROR] Type error at %s:%i:%i: "
+		"rvalue doesnt match type of lvalue\n",
+		fileName.c_str(),
+		(int) token.line,
+		(int) token.column
+	);
 	exit(EXIT_FAILURE);
 }
 
-bool Language::LanguageComponents::CXXFunctionExists(std::string name) {
-	for (auto& func : functions) {
-		if (func.name == name) {
-			return true;
+void Language::LanguageComponents::PushLiteral(const Lexer::Token& token) {
+	passStack.push_back(token.value);
+}
+
+void Language::LanguageComponents::PushIdentifier(
+	const Lexer::Token& token, size_t slot, size_t address
+) {
+	if (VariableExists(slot)) {
+		passStack.push_back(Variable(slot));
+		return;
+	}
+	if ((address == Bytecode::NoAddress) && LabelExists(std::string(token.content))) {
+		// label from an include, bound unless a task shares the code
+		address = GetLabel(std::string(token.content));
+		if (Program* own = OwnProgram()) {
+			own->code[i].operand = address;
 		}
 	}
-	return false;
+	if (address == Bytecode::NoAddress) {
+		fprintf(
+			stderr,
+			"[ERROR] Referenced undefined variable/label %.*s at %s:%i:%i\n",
+			(int) token.content.length(), token.content.data(),
+			fileName.c_str(),
+			(int) token.line,
+			(int) token.column
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	passStack.push_back(address);
 }
 
-void
-Language::LanguageComponents::AssignVariable(std::string name) {
-	Language::Variable newVar = GetVariable(name);
-	auto& token = tokens[i];
-	switch (token.type) {
-		case Lexer::TokenType::String: {
-			if (newVar.type != Language::Type::String) {
-				fprintf(
-					stderr,
-					"[ERROR] Type error at %s:%i:%i: "
-					"rvalue doesnt match type of lvalue\n",
-					fileName.c_str(),
-					(int) token.line,
-					(int) token.column
-				);
-				exit(EXIT_FAILURE);
-			}
-			newVar.value = token.content;
-			break;
-		}
-		case Lexer::TokenType::Integer: {
-			if (
-				(newVar.type != Language::Type::Integer) &&
-				(newVar.type != Language::Type::Word)
-			) {
-				fprintf(
-					stderr,
-					"[ERROR] Type error at %s:%i:%i: "
-					"rvalue doesnt match type of lvalue\n",
-					fileName.c_str(),
-					(int) token.line,
-					(int) token.column
-				);
-				exit(EXIT_FAILURE);
-			}
-			switch (newVar.type) {
-				case Language::Type::Integer: {
-					newVar.value = (int32_t) std::stoi(token.content);
-					break;
-				}
-				case Language::Type::Word: {
-					newVar.value = (size_t) std::stol(token.content);
-					break;
-				}
-				default: break;
-			}
-			break;
-		}
-		case Lexer::TokenType::Float: {
-			if (newVar.type != Language::Type::Float) {
-				fprintf(
-					stderr,
-					"[ERROR] Type error at %s:%i:%i: "
-					"rvalue doesnt match type of lvalue\n",
-					fileName.c_str(),
-					(int) token.line,
-					(int) token.column
-				);
-				exit(EXIT_FAILURE);
-			}
-			newVar.value = std::stod(token.content);
-			break;
-		}
-		case Lexer::TokenType::Bool: {
-			if (newVar.type != Language::Type::Bool) {
-				fprintf(
-					stderr,
-					"[ERROR] Type error at %s:%i:%i: "
-					"rvalue doesnt match type of lvalue\n",
-					fileName.c_str(),
-					(int) token.line,
-					(int) token.column
-				);
-				exit(EXIT_FAILURE);
-			}
-			newVar.value = token.content == "true";
-			break;
-		}
-		case Lexer::TokenType::FunctionOrIdentifier: {
-			if (LabelExists(token.content) || CXXFunctionExists(token.content)) {
-				// function
-				//if (LabelExists(token.content)) puts("label");
-				//if (CXXFunctionExists(token.content)) puts("function");
-				FunctionCall();
-				if (returnValues.empty()) {
-					fprintf(
-						stderr,
-						"[ERROR] No value to assign at %s:%i:%i (function returned nothing)\n",
-						fileName.c_str(),
-						(int) token.line,
-						(int) token.column
-					);
-					exit(EXIT_FAILURE);
-				}
-				Language::Variable ret = returnValues.back();
-				returnValues.pop_back();
-				if (ret.type != newVar.type) {
-					fprintf(
-						stderr,
-						"[ERROR] Return value doesnt match type of lvalue at %s:%i:%i\n",
-						fileName.c_str(),
-						(int) token.line,
-						(int) token.column
-					);
-					exit(EXIT_FAILURE);
-				}
-				newVar      = ret;
-				newVar.name = name;
-			}
-			else { // identifier
-				Language::Variable set =
-					GetVariable(token.content);
-				if (set.type != newVar.type) {
-					fprintf(
-						stderr,
-						"[ERROR] Type error at %s:%i:%i: "
-						"rvalue doesnt match type of lvalue\n",
-						fileName.c_str(),
-						(int) token.line,
-						(int) token.column
-					);
-					exit(EXIT_FAILURE);
-				}
-				newVar = set;
-				newVar.name = name;
-			}
-			break;
-		}
-		default: {
-			fprintf(
-				stderr, "[ERROR] (1) Unexpected token %s at %s:%i:%i\n",
-				Lexer::TypeAsString(token).c_str(),
-				fileName.c_str(),
-				(int) token.line,
-				(int) token.column
-			);
-			exit(EXIT_FAILURE);
+void Language::LanguageComponents::PushMove(size_t slot) {
+	passStack.push_back(std::move(GetVariable(slot)));
+}
+
+size_t Language::LanguageComponents::ProfileLabel(size_t address) {
+	size_t entry = profiler->FindLabel(address);
+	if (entry != Profiler::NoEntry) {
+		return entry;
+	}
+
+	// sub-labels are also stored under their bare name, use the full one
+	std::string name = "?";
+	for (auto& label : program->labels) {
+		if ((label.second == address) && (label.first.length() > name.length())) {
+			name = label.first;
 		}
 	}
+	return profiler->AddLabel(address, name);
+}
 
-	SetVariable(newVar);
+// by index, calls to one builtin can be bound to versions for different types
+size_t Language::LanguageComponents::ProfileBuiltin(size_t builtin) {
+	const void* function = (const void*) functions[builtin].function;
+	size_t      entry    = profiler->FindBuiltin(function);
+	if (entry != Profiler::NoEntry) {
+		return entry;
+	}
+	return profiler->AddBuiltin(function, functions[builtin].name);
 }
 
-void Language::LanguageComponents::FunctionCall() {
-	auto& token = tokens[i];
-	while (tokens[i].type != Lexer::TokenType::End) {
-		Language::Variable toPush;
-		++ i;
-		if (tokens[i].type == Lexer::TokenType::End) {
-			break;
-		}
-		switch (tokens[i].type) {
-			case Lexer::TokenType::String: {
-				toPush.type  = Language::Type::String;
-				toPush.value = tokens[i].content;
-				break;
-			}
-			case Lexer::TokenType::Integer: {
-				toPush.type  = Language::Type::Integer;
-				toPush.value = std::stoi(tokens[i].content);
-				break;
-			}
-			case Lexer::TokenType::Float: {
-				toPush.type  = Language::Type::Float;
-				toPush.value = std::stod(tokens[i].content);
-				break;
-			}
-			case Lexer::TokenType::Bool: {
-				toPush.type  = Language::Type::Bool;
-				toPush.value = tokens[i].content == "true";
-				break;
-			}
-			case Lexer::TokenType::Identifier: {
-				if (VariableExists(tokens[i].content)) {
-					Language::Variable var =
-						GetVariable(tokens[i].content);
-					toPush = var;
-				}
-				else if (LabelExists(tokens[i].content)) {
-					toPush.type  = Language::Type::Word;
-					toPush.value = GetLabel(tokens[i].content);
-				}
-				else {
-					fprintf(
-						stderr,
-						"[ERROR] Referenced undefined variable/label %s at %s:%i:%i\n",
-						tokens[i].content.c_str(),
-						fileName.c_str(),
-						(int) tokens[i].line,
-						(int) tokens[i].column
-					);
-					exit(EXIT_FAILURE);
-				}
-				break;
-			}
-			default: {
-				printf("%i\n", (int) i);
-				fprintf(
-					stderr, "[ERROR] (2) Unexpected token %s at %s:%i:%i\n",
-					Lexer::TypeAsString(token).c_str(),
-					fileName.c_str(),
-					(int) tokens[i].line,
-					(int) tokens[i].column
-				);
-				exit(EXIT_FAILURE);
-			}
-		}
+// the label's Nop says how many locals it declares
+Language::Frame Language::LanguageComponents::FrameAt(size_t label, size_t base) {
+	auto& code = program->code;
+	if ((label >= code.size()) || (code[label].op != Bytecode::Opcode::Nop)) {
+		return {0, 0, base, label};
+	}
+	return {code[label].variable, code[label].operand, base, label};
+}
 
-		passStack.push_back(toPush);
+// the locals start out deleted
+void Language::LanguageComponents::EnterFrame(size_t address, size_t base) {
+	frame = FrameAt(address, base);
+	if ((frame.size != 0) || (locals.size() != base)) {
+		locals.resize(base);
+		locals.resize(base + frame.size);
 	}
+}
 
-	bool               functionExists = false;
-	bool               cxxFunction    = false;
-	if (CXXFunctionExists(token.content)) {
-		functionExists = true;
-		cxxFunction    = true;
+// calls are made by the interpreter loop, which carries on at the label
+void Language::LanguageComponents::CallLabel(size_t address) {
+	if (profiler != nullptr) {
+		profiler->Enter(ProfileLabel(address));
 	}
-	else if (LabelExists(token.content)) {
-		functionExists = true;
+	// a call right before a return is a tail call, the callee can return
+	// straight to our caller and reuse our locals, profiling needs to see
+	// every frame though
+	else if (
+		(program->code[i].op == Bytecode::Opcode::CallLabel) &&
+		(program->code[i + 1].op == Bytecode::Opcode::Return) && !returnStack.empty()
+	) {
+		EnterFrame(address, frame.base);
+		i = address;
+		return;
 	}
-	if (!functionExists) {
+
+	if (returnStack.size() >= maxDepth) {
+		auto& token = program->tokens[program->code[i].token];
 		fprintf(
 			stderr,
-			"[ERROR] Referenced undefined function %s at %s:%i:%i\n",
-			token.content.c_str(),
+			"[ERROR] Call stack overflow at %s:%i:%i: more than %llu nested label "
+			"calls (see --max-depth)\n",
+			fileName.c_str(), (int) token.line, (int) token.column,
+			(unsigned long long int) maxDepth
+		);
+		exit(EXIT_FAILURE);
+	}
+	returnStack.push_back({i, frame.label});
+	EnterFrame(address, locals.size());
+	i = address;
+}
+
+// for calls from C++ that need the result straight away
+void Language::LanguageComponents::CallLabelAndWait(size_t address) {
+	CallLabel(address);
+	Interpret(*this, returnStack.size());
+}
+
+void Language::LanguageComponents::ReturnFromLabel() {
+	// freeing the locals doesn't free the vector's memory, the next call
+	// reuses it
+	if (locals.size() != frame.base) {
+		locals.resize(frame.base);
+	}
+	Language::Frame caller = FrameAt(returnStack.back().label, 0);
+	caller.base = frame.base - caller.size;
+	frame       = caller;
+	i           = returnStack.back().address;
+	returnStack.pop_back();
+	if (profiler != nullptr) {
+		profiler->Leave();
+	}
+}
+
+void Language::LanguageComponents::CallName(const Lexer::Token& token) {
+	if (!LabelExists(std::string(token.content))) {
+		fprintf(
+			stderr,
+			"[ERROR] Referenced undefined function %.*s at %s:%i:%i\n",
+			(int) token.content.length(), token.content.data(),
 			fileName.c_str(),
-			(int) tokens[i].line,
-			(int) tokens[i].column
+			(int) token.line,
+			(int) token.column
 		);
 		exit(EXIT_FAILURE);
 	}
 
-	if (cxxFunction) {
-		//puts("cxxFunction");
-		CallCXXFunction(token.content);
+	// bind the call site so that later calls go straight to the label,
+	// unless a task shares the code
+	size_t address = GetLabel(std::string(token.content));
+	if (Program* own = OwnProgram()) {
+		own->code[i].op      = Bytecode::Opcode::CallLabel;
+		own->code[i].operand = address;
+		++ own->boundCalls;
 	}
-	else {
-		//puts("label function");
-		returnStack.push_back(i);
-		//printf("jumping from %i to %i\n", (int) i, (int) labelPos);
-		JumpToLabel(token.content);
-		Interpret(*this, true);
+	CallLabel(address);
+}
+
+void Language::LanguageComponents::AssignLiteral(
+	size_t slot, const Lexer::Token& token
+) {
+	Language::Value& newVar = GetVariable(slot);
+	Language::Type   type   = Language::ValueType(token.value);
+	if (type == newVar.GetType()) {
+		newVar = token.value;
+		return;
 	}
+
+	// integer literals can be assigned to words
+	if ((type == Language::Type::Integer) && (newVar.GetType() == Language::Type::Word)) {
+		newVar = (size_t) token.value.Get <int32_t>();
+		return;
+	}
+	TypeError(fileName, token);
 }
 
-void Language::LanguageComponents::CopyNewLC(LanguageComponents& lc) {
-	for (auto& var : lc.variables) {
-		variables.push_back(var);
+void Language::LanguageComponents::AssignReturn(
+	size_t slot, const Lexer::Token& token
+) {
+	Language::Value& newVar = GetVariable(slot);
+	if (returnValues.empty()) {
+		fprintf(
+			stderr,
+			"[ERROR] No value to assign at %s:%i:%i (function returned nothing)\n",
+			fileName.c_str(),
+			(int) token.line,
+			(int) token.column
+		);
+		exit(EXIT_FAILURE);
+	}
+	Language::Value& ret = returnValues.back();
+	if (ret.GetType() != newVar.GetType()) {
+		fprintf(
+			stderr,
+			"[ERROR] Return value doesnt match type of lvalue at %s:%i:%i\n",
+			fileName.c_str(),
+			(int) token.line,
+			(int) token.column
+		);
+		exit(EXIT_FAILURE);
 	}
-	for (auto& function : lc.functions) {
-		functions.push_back(function);
+	newVar = std::move(ret);
+	returnValues.pop_back();
+}
+
+void Language::LanguageComponents::AssignName(
+	size_t slot, size_t from, const Lexer::Token& token
+) {
+	if (LabelExists(std::string(token.content))) {
+		// the call can include more code, so don't hold on to the token
+		Lexer::Token function = token;
+		CallLabelAndWait(GetLabel(std::string(function.content)));
+		AssignReturn(slot, function);
+		return;
 	}
-	for (auto& token : lc.tokens) {
-		tokens.push_back(token);
+
+	AssignVariable(slot, from, token);
+}
+
+void Language::LanguageComponents::AssignVariable(
+	size_t slot, size_t from, const Lexer::Token& token
+) {
+	Language::Value& newVar = GetVariable(slot);
+	Language::Value& set    = GetVariable(from);
+	if (set.GetType() != newVar.GetType()) {
+		TypeError(fileName, token);
 	}
+	newVar = set;
 }
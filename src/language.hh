@@ -1,66 +1,152 @@
 #pragma once
 #include "_components.hh"
+#include "value.hh"
 #include "lexer.hh"
+#include "bytecode.hh"
+#include "fs.hh"
+#include "output.hh"
+#include "profiler.hh"
+#include "pool.hh"
 
 namespace Language {
 	constexpr const char* keywords[] = {
 		"let",
+		"local",
 		"del"
 	};
-	enum class Type {
-		String = 0,
-		Integer,
-		Float,
-		Bool,
-		Word,
-		Err
-	};
 	Type        StringToType(std::string type);
 	std::string TypeToString(Type type);
-	typedef std::variant <std::string, int32_t, double, bool, size_t> Value;
-	struct Variable {
-		std::string name;
-		Type        type;
-		Value       value;
-	};
-	class LanguageComponents;
-	typedef void (*CXXFunction)(LanguageComponents&);
 	struct Function {
 		std::string name;
 		CXXFunction function;	
 	};
+	// the locals of a running label call, local ids first to first + size
+	// are stored from locals[base], label is the Nop the call went to
+	struct Frame {
+		size_t first;
+		size_t size;
+		size_t base;
+		size_t label;
+	};
+	// the caller's frame is found again from its label, its locals end
+	// where the callee's start, which keeps deep recursion's stack small
+	struct Call {
+		size_t address; // to return to
+		size_t label;   // of the caller's frame
+	};
+	// the code and everything that describes it. tasks started with spawn
+	// share it with the thread that started them, so it's only changed
+	// through LanguageComponents::EditProgram, which copies it first while
+	// it's shared
+	struct Program {
+		std::vector <Lexer::Token> tokens;
+		// source code the tokens point into
+		std::vector <std::shared_ptr <FS::File::Source>> sources;
+		std::vector <Bytecode::Instruction>      code;
+		std::unordered_map <std::string, size_t> labels;
+		std::unordered_map <std::string, size_t> variableSlots;
+		std::vector <std::string>                variableNames; // by slot
+		std::vector <std::string>                localNames; // by id
+		// by local id, the global slot a local is stored in when its
+		// label's code runs without a call to it, after a goto
+		std::vector <size_t>                     localGlobals;
+		std::unordered_set <std::string>         modules; // included paths
+		size_t                                   boundCalls = 0;
+		// tokens before this one have their strings made literals, so
+		// threads can copy them, see String::MakeLiteral
+		size_t                                   literals = 0;
+		// set once a task has been given the program, from then on every
+		// lc holding it copies it before changing it
+		bool                                     shared = false;
+	};
+	class LanguageComponents;
+	// a label started by spawn, its lc shares the program and has its own
+	// variables and stacks, which only the job uses until join waits for it.
+	// a task that's never joined is waited for when it's freed
+	struct Task {
+		std::shared_ptr <Pool::Job>          job;
+		std::unique_ptr <LanguageComponents> lc;
+
+		~Task();
+	};
 	class LanguageComponents {
 		public:
+			std::shared_ptr <const Program> program;
+
 			// variables
-			std::vector <Variable>     variables;
-			std::vector <Variable>     passStack;
+			std::vector <Value>        variables; // indexed by slot
+			std::vector <Value>        locals; // of every label call
+			Frame                      frame;
+			std::vector <Value>        passStack;
 			std::vector <Function>     functions;
-			std::vector <Lexer::Token> tokens;
-			std::vector <size_t>       returnStack;
-			std::vector <Variable>     returnValues;
+			std::vector <Call>         returnStack;
+			std::vector <Value>        returnValues;
 			std::vector <size_t>       argStart;
 			size_t                     i;
 			std::string                fileName;
+			size_t                     executed; // instructions run
+			size_t                     maxDepth; // of label calls
+			// spawned labels by handle, before output so that it's flushed
+			// before they're waited for
+			std::unordered_map <size_t, Task> tasks;
+			size_t                     nextTask;
+			Output::Buffer             output;
+			// only set with --profile
+			std::unique_ptr <Profiler::Recorder> profiler;
 
 			// functions
 			LanguageComponents();
 
 			// util functions
-			void     Init(std::vector <Lexer::Token> p_tokens, std::string p_fileName);
-			void     RegisterFunction(Function function);
-			void     JumpToLabel(std::string name);
-			Variable GetVariable(std::string name);
-			void     SetVariable(Variable variable);
-			void     AddVariable(Variable variable);
-			void     DeleteVariable(std::string name);
-			bool     VariableExists(std::string name);
-			bool     LabelExists(std::string name);
-			size_t   GetLabel(std::string name);
-			void     CreateVariable(Type type, std::string name);
-			void     CallCXXFunction(std::string name);
-			bool     CXXFunctionExists(std::string name);
-			void     AssignVariable(std::string name);
-			void     FunctionCall();
-			void     CopyNewLC(LanguageComponents& lc);
+			void      Init(std::vector <Lexer::Token> p_tokens, std::string p_fileName);
+			// the program to change, copied first if a task shares it
+			Program&  EditProgram();
+			// the program when no task shares it, for changes that can be
+			// left out, like binding a call site, nullptr otherwise
+			Program*  OwnProgram();
+			void      RegisterFunction(Function function);
+			void      JumpToLabel(std::string name);
+			size_t    VariableSlot(std::string name);
+			std::string VariableName(size_t slot);
+			Value&    GetVariable(size_t slot);
+			void      DeleteVariable(size_t slot);
+			bool      LabelExists(std::string name);
+			size_t    GetLabel(std::string name);
+			void      CreateVariable(Type type, size_t slot);
+			void      PushLiteral(const Lexer::Token& token);
+			void      PushIdentifier(
+				const Lexer::Token& token, size_t slot, size_t address
+			);
+			void      PushMove(size_t slot);
+			size_t    ProfileLabel(size_t address);
+			size_t    ProfileBuiltin(size_t builtin);
+			Frame     FrameAt(size_t label, size_t base);
+			void      EnterFrame(size_t address, size_t base);
+			void      CallLabel(size_t address);
+			void      CallLabelAndWait(size_t address);
+			void      ReturnFromLabel();
+			void      CallName(const Lexer::Token& token);
+			void      AssignLiteral(size_t slot, const Lexer::Token& token);
+			void      AssignReturn(size_t slot, const Lexer::Token& token);
+			void      AssignName(size_t slot, size_t from, const Lexer::Token& token);
+			void      AssignVariable(size_t slot, size_t from, const Lexer::Token& token);
+
+			// where the variable in slot is stored, globals and the locals of
+			// the current label call can be used. a label's code that runs
+			// outside a call to it, after a goto, has no frame, its locals are
+			// the globals with their names then
+			Value& Variable(size_t slot) {
+				if ((slot & Bytecode::LocalSlot) == 0) {
+					return variables[slot];
+				}
+				size_t offset = (slot & ~Bytecode::LocalSlot) - frame.first;
+				if (offset >= frame.size) {
+					return variables[program->localGlobals[slot & ~Bytecode::LocalSlot]];
+				}
+				return locals[frame.base + offset];
+			}
+			bool VariableExists(size_t slot) {
+				return Variable(slot).GetType() != Type::Err;
+			}
 	};
 }
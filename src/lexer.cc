@@ -1,231 +1,249 @@
 #include "lexer.hh"
 #include "language.hh"
-#include "util.hh"
 
-std::vector <Lexer::Token> Lexer::Lex(std::string code, std::string fname) {
-	size_t                     line   = 1;
-	size_t                     column = 1;
-	std::vector <Lexer::Token> ret;
-	std::string                reading;
-	bool                       err    = false;
-	bool                       inString = false;
-	for (size_t i = 0; i <= code.length(); ++i) {
-		if ((i == 0) && (code[i] == '#')) {
-			while (code[i] != '\n') {
-				++ i;
-			}
-			++ line;
+static bool IsKeyword(std::string_view word) {
+	for (auto keyword : Language::keywords) {
+		if (word == keyword) {
+			return true;
 		}
-		if (code[i] == '\n') {
-			++ line;
-			column = 1;
+	}
+	return false;
+}
+
+// classifies and parses a number in one pass, returns false if the token
+// isn't a number
+static bool ParseNumber(Lexer::Token& token, bool& inRange) {
+	const char* begin  = token.content.data();
+	const char* end    = begin + token.content.length();
+	const char* digits = (*begin == '-')? begin + 1 : begin;
+	if ((digits == end) || !(isdigit(*digits) || (*digits == '.'))) {
+		return false;
+	}
+
+	int32_t integer = 0;
+	auto    result = std::from_chars(begin, end, integer);
+	if (result.ptr == end) {
+		token.type = Lexer::TokenType::Integer;
+		if (result.ec == std::errc()) {
+			token.value = integer;
+			return true;
 		}
-		else {
-			++ column;
+		// too big for an integer, but can still be assigned to a word
+		size_t word = 0;
+		result  = std::from_chars(begin, end, word);
+		inRange = (result.ptr == end) && (result.ec == std::errc());
+		token.value = word;
+		return true;
+	}
+
+	double number = 0.0;
+	result = std::from_chars(begin, end, number, std::chars_format::fixed);
+	if (result.ptr == end) {
+		token.type  = Lexer::TokenType::Float;
+		token.value = number;
+		inRange     = result.ec == std::errc();
+		return true;
+	}
+	return false;
+}
+
+std::vector <Lexer::Token> Lexer::Lex(
+	std::string_view code, std::string fname, bool* failed
+) {
+	std::vector <Lexer::Token> ret;
+	size_t                     line        = 1;
+	size_t                     column      = 1;
+	size_t                     start       = 0; // start of the word being read
+	size_t                     startLine   = 0;
+	size_t                     startColumn = 0;
+	bool                       reading     = false;
+	bool                       inString    = false;
+	bool                       err         = false;
+
+
+	// roughly one token per 4 bytes of source, avoids copying tokens while
+	// the vector grows
+	ret.reserve(code.length() / 4 + 1);
+
+	auto error = [&](const char* message, size_t errLine, size_t errColumn) {
+		fprintf(
+			stderr, "[ERROR] at %s:%i:%i : %s\n",
+			fname.c_str(), (int) errLine, (int) errColumn, message
+		);
+		err = true;
+	};
+
+	auto endStatement = [&]() {
+		if (!ret.empty() && (ret.back().type != Lexer::TokenType::End)) {
+			ret.push_back({Lexer::TokenType::End, "", line, column});
 		}
-		switch (code[i]) {
-			case '=': {
-				if (inString) {
-					reading += code[i];
-					break;
-				}
-				if (!reading.empty()) {
-					fprintf(
-						stderr, "[ERROR] at %s:%i:%i : no space before = token\n",
-						fname.c_str(), (int) line, (int) column
-					);
-					err = true;
-					continue;
-				}
-				if (ret.empty()) {
-					fprintf(
-						stderr, "[ERROR] at %s:%i:%i : nothing to assign to\n",
-						fname.c_str(), (int) line, (int) column
-					);
-					err = true;
-					continue;
-				}
-				if (ret.back().type == Lexer::TokenType::FunctionCall) {
-					ret.back().type = Lexer::TokenType::Identifier;
-				}
+	};
+
+	auto finishWord = [&](size_t end) {
+		if (!reading) {
+			return;
+		}
+		reading = false;
+
+		std::string_view word = code.substr(start, end - start);
+		if (ret.empty() || (ret.back().type == Lexer::TokenType::End)) {
+			if (word[0] == '@') {
 				ret.push_back({
-					Lexer::TokenType::Equals,
-					"",
-					line, column
+					Lexer::TokenType::Label, word.substr(1), startLine, startColumn
 				});
-				break;
+				endStatement();
 			}
-			case '"': {
-				inString =  !inString;
-				reading  += code[i];
-				break;
+			else {
+				// either a function or a keyword
+				ret.push_back({
+					IsKeyword(word)?
+						Lexer::TokenType::Keyword : Lexer::TokenType::FunctionCall,
+					word, startLine, startColumn
+				});
 			}
-			case '/': {
-				++ i;
-				if (code[i] == '/') {
-					while (code[i] != '\n') {
-						++ i;
-					}
-				}
-				else if (code[i] == '*') {
-					while (true) {
-						if ((code[i] == '*') && (code[i + 1] == '/')) {
-							break;
-						}
-					}
-					++ i;
-					break;
-				}
+			return;
+		}
+		if (
+			(ret.back().type == Lexer::TokenType::Keyword) &&
+			((ret.back().content == "let") || (ret.back().content == "local"))
+		) {
+			ret.push_back({Lexer::TokenType::Type, word, startLine, startColumn});
+			return;
+		}
+
+		// argument
+		Lexer::Token token = {
+			Lexer::TokenType::Identifier, word, startLine, startColumn
+		};
+		bool inRange = true;
+		if (ParseNumber(token, inRange)) {
+			if (!inRange) {
+				error("number literal is out of range", startLine, startColumn);
 			}
-			// fall through
-			case '\t':
-			case ' ':
-			case '\n':
-			case '\0': {
-				if (inString) {
-					reading += code[i];
-					break;
-				}
-				if (reading.empty()) {
-					continue;
-				}
-				if ((ret.size() == 0) || (ret.back().type == Lexer::TokenType::End)) {
-					// might be a label
-					if (reading[0] == '@') {
-						ret.push_back({
-							Lexer::TokenType::Label,
-							reading.substr(1),
-							line, column
-						});
-						reading = "";
-						ret.push_back({
-							Lexer::TokenType::End,
-							"",
-							line, column
-						});
-						continue;
-					}
-					// either a function or a keyword
-					bool isKeyword = false;
-					for (
-						size_t i = 0; i < sizeof(Language::keywords) / sizeof(char*);
-						++i
-					) {
-						if (reading == Language::keywords[i]) {
-							isKeyword = true;
-							break;
-						}
-					}
+		}
+		else if ((word == "true") || (word == "false")) {
+			token.type  = Lexer::TokenType::Bool;
+			token.value = word == "true";
+		}
+		else if ((word.length() >= 2) && (word[0] == '"') && (word.back() == '"')) {
+			token.type    = Lexer::TokenType::String;
+			token.content = word.substr(1, word.length() - 2);
+			token.value   = Language::String(EscapeString(token.content));
+		}
+		else if (ret.back().type == Lexer::TokenType::Equals) {
+			token.type = Lexer::TokenType::FunctionOrIdentifier;
+		}
+		ret.push_back(std::move(token));
+	};
 
-					if (isKeyword) {
-						ret.push_back({
-							Lexer::TokenType::Keyword,
-							reading,
-							line, column
-						});
-						reading = "";
-					}
-					else {
-						// function
-						ret.push_back({
-							Lexer::TokenType::FunctionCall,
-							reading,
-							line, column
-						});
-						reading = "";
-					}
-					if ((code[i] == '\n') || (code[i] == '\0')) {
-						ret.push_back({
-							Lexer::TokenType::End,
-							"",
-							line, column
-						});
+	size_t i = 0;
+	if (!code.empty() && (code[0] == '#')) {
+		while ((i < code.length()) && (code[i] != '\n')) {
+			++ i;
+		}
+	}
+
+	for (; i <= code.length(); ++i) {
+		char ch = (i < code.length())? code[i] : '\0';
+
+		if (inString) {
+			if (ch == '"') {
+				inString = false;
+			}
+			else if (i == code.length()) {
+				error("unterminated string", startLine, startColumn);
+			}
+		}
+		else {
+			switch (ch) {
+				case '"': {
+					inString = true;
+					if (!reading) {
+						reading     = true;
+						start       = i;
+						startLine   = line;
+						startColumn = column;
 					}
-					continue;
-				}
-				else if (
-					(ret.back().type == Lexer::TokenType::Keyword) &&
-					(ret.back().content == "let")
-				) {
-					ret.push_back({
-						Lexer::TokenType::Type,
-						reading,
-						line, column
-					});
-					reading = "";
+					break;
 				}
-				else {
-					// argument
-					if (Util::IsInteger(reading)) {
-						ret.push_back({
-							Lexer::TokenType::Integer,
-							reading,
-							line, column
-						});
-						reading = "";
+				case '=': {
+					if (reading) {
+						error("no space before = token", line, column);
+						reading = false;
+						break;
 					}
-					else if (Util::IsFloat(reading)) {
-						ret.push_back({
-							Lexer::TokenType::Float,
-							reading,
-							line, column
-						});
-						reading = "";
+					if (ret.empty()) {
+						error("nothing to assign to", line, column);
+						break;
 					}
-					else if (Util::IsBool(reading)) {
-						ret.push_back({
-							Lexer::TokenType::Bool,
-							reading,
-							line, column
-						});
-						reading = "";
+					if (ret.back().type == Lexer::TokenType::FunctionCall) {
+						ret.back().type = Lexer::TokenType::Identifier;
 					}
-					else if ((reading[0] == '"') && (reading.back() == '"')) {
-						ret.push_back({
-							Lexer::TokenType::String,
-							EscapeString(reading.substr(1, reading.length() - 2)),
-							line, column
-						});
-						reading = "";
+					ret.push_back({Lexer::TokenType::Equals, "", line, column});
+					break;
+				}
+				case '/': {
+					char next = (i + 1 < code.length())? code[i + 1] : '\0';
+					if (next == '/') {
+						finishWord(i);
+						while ((i + 1 < code.length()) && (code[i + 1] != '\n')) {
+							++ i;
+						}
+						break;
 					}
-					else {
-						if (
-							!ret.empty() &&
-							(ret.back().type == Lexer::TokenType::Equals)
-						) {
-							ret.push_back({
-								Lexer::TokenType::FunctionOrIdentifier,
-								reading,
-								line, column
-							});
+					if (next == '*') {
+						finishWord(i);
+						size_t end = code.find("*/", i + 2);
+						if (end == std::string_view::npos) {
+							error("unterminated comment", line, column);
+							end = code.length() - 1;
 						}
-						else {
-							ret.push_back({
-								Lexer::TokenType::Identifier,
-								reading,
-								line, column
-							});
+						for (; i < end + 1; ++i) {
+							if (code[i] == '\n') {
+								++ line;
+								column = 0;
+							}
+							++ column;
 						}
-						reading = "";
+						break;
 					}
 				}
-
-				if ((code[i] == '\n') || (code[i] == '\0')) {
-					ret.push_back({
-						Lexer::TokenType::End,
-						"",
-						line, column
-					});
+				// fall through
+				default: {
+					if (!reading) {
+						reading     = true;
+						start       = i;
+						startLine   = line;
+						startColumn = column;
+					}
+					break;
+				}
+				case ' ':
+				case '\t':
+				case '\r':
+				case '\n':
+				case '\0': {
+					finishWord(i);
+					if ((ch == '\n') || (i == code.length())) {
+						endStatement();
+					}
+					break;
 				}
-				break;
-			}
-			default: {
-				reading += code[i];
-				break;
 			}
 		}
+
+		if (ch == '\n') {
+			++ line;
+			column = 1;
+		}
+		else {
+			++ column;
+		}
 	}
 
+	if (failed != nullptr) {
+		*failed = err;
+	}
 	if (err) {
 		return {};
 	}
@@ -253,14 +271,15 @@ std::string Lexer::TypeAsString(Token token) {
 void Lexer::Visualise(std::vector <Lexer::Token> tokens) {
 	for (size_t i = 0; i < tokens.size(); ++i) {
 		printf(
-			"%i: %s, %s (%i:%i)\n",
-			(int) i, Lexer::TypeAsString(tokens[i]).c_str(), tokens[i].content.c_str(),
+			"%i: %s, %.*s (%i:%i)\n",
+			(int) i, Lexer::TypeAsString(tokens[i]).c_str(),
+			(int) tokens[i].content.length(), tokens[i].content.data(),
 			(int) tokens[i].line, (int) tokens[i].column
 		);
 	}
 }
 
-std::string Lexer::EscapeString(std::string str) {
+std::string Lexer::EscapeString(std::string_view str) {
 	std::string ret;
 	for (size_t i = 0; i < str.length(); ++i) {
 		if (str[i] == '\\') {
@@ -1,5 +1,6 @@
 #pragma once
 #include "_components.hh"
+#include "value.hh"
 
 namespace Lexer {
 	enum class TokenType {
@@ -17,12 +18,18 @@ namespace Lexer {
 		End
 	};
 	struct Token {
-		TokenType   type;
-		std::string content;
-		size_t      line, column;
+		TokenType        type;
+		std::string_view content; // points into the source code
+		size_t           line, column;
+		Language::Value  value = {}; // parsed value of literals
 	};
-	std::vector <Token> Lex(std::string code, std::string fname);
+	// the tokens point into code, so it has to outlive them. errors are
+	// reported as they're found, then no tokens are returned and failed is
+	// set, which tells them apart from code that has no tokens
+	std::vector <Token> Lex(
+		std::string_view code, std::string fname, bool* failed = nullptr
+	);
 	std::string         TypeAsString(Token token);
 	void                Visualise(std::vector <Token> tokens);
-	std::string         EscapeString(std::string str);
+	std::string         EscapeString(std::string_view str);
 }
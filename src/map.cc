@@ -0,0 +1,320 @@
+#include "builtin.hh"
+
+// Map's table and the map builtins
+
+static uint64_t Mix(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// 8 bytes at a time, each mixed in with a multiply, then mixed properly once
+static uint64_t HashBytes(const char* bytes, size_t length) {
+	uint64_t hash = length * 0x9e3779b97f4a7c15ull;
+	size_t   j    = 0;
+	for (; j + 8 <= length; j += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + j, 8);
+		hash  = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+		hash ^= hash >> 32;
+	}
+	if (j < length) {
+		uint64_t word = 0;
+		memcpy(&word, bytes + j, length - j);
+		hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+	}
+	return Mix(hash);
+}
+
+static uint32_t Hash(const Language::Value& key) {
+	switch (key.GetType()) {
+		case Language::Type::String: {
+			const std::string& str = key.Get <Language::String>().Get();
+			return (uint32_t) HashBytes(str.data(), str.length());
+		}
+		case Language::Type::Integer: {
+			return (uint32_t) Mix((uint64_t) (uint32_t) key.Get <int32_t>() ^ (1ull << 63));
+		}
+		default: {
+			return (uint32_t) Mix((uint64_t) key.Get <size_t>());
+		}
+	}
+}
+
+static bool KeysEqual(const Language::Value& first, const Language::Value& second) {
+	if (first.GetType() != second.GetType()) {
+		return false;
+	}
+	switch (first.GetType()) {
+		case Language::Type::String: {
+			return first.Get <Language::String>() == second.Get <Language::String>();
+		}
+		case Language::Type::Integer: {
+			return first.Get <int32_t>() == second.Get <int32_t>();
+		}
+		default: {
+			return first.Get <size_t>() == second.Get <size_t>();
+		}
+	}
+}
+
+// the slot key is in, or the free slot it would go in. the table is never
+// full, so there is always a free slot to stop at
+static size_t FindSlot(
+	const Language::Map::Data& table, const Language::Value& key, uint32_t hash
+) {
+	size_t mask = table.slots.size() - 1;
+	for (size_t j = hash & mask;; j = (j + 1) & mask) {
+		auto& slot = table.slots[j];
+		if (
+			(slot.entry == Language::Map::Data::Empty) ||
+			((slot.hash == hash) && KeysEqual(table.entries[slot.entry].key, key))
+		) {
+			return j;
+		}
+	}
+}
+
+// at most 3/4 of the slots are used, which keeps probes short
+static void Grow(Language::Map::Data& table) {
+	size_t size = std::max((size_t) 16, table.slots.size() * 2);
+	std::vector <Language::Map::Data::Slot> slots(size, {0, Language::Map::Data::Empty});
+	for (auto& slot : table.slots) {
+		if (slot.entry == Language::Map::Data::Empty) {
+			continue;
+		}
+		size_t j = slot.hash & (size - 1);
+		while (slots[j].entry != Language::Map::Data::Empty) {
+			j = (j + 1) & (size - 1);
+		}
+		slots[j] = slot;
+	}
+	table.slots = std::move(slots);
+	table.entries.reserve(size / 4 * 3);
+}
+
+Language::Map::Map(): data(new Data()) {
+	data->references = 1;
+}
+
+Language::Value* Language::Map::Find(const Value& key) const {
+	Data& table = *Table();
+	if (table.entries.empty()) {
+		return nullptr;
+	}
+	auto& slot = table.slots[FindSlot(table, key, Hash(key))];
+	return (slot.entry == Data::Empty)? nullptr : &table.entries[slot.entry].value;
+}
+
+void Language::Map::Set(const Value& key, Value value) {
+	Data&    table = *Table();
+	uint32_t hash  = Hash(key);
+	size_t   slot  = 0;
+	if (!table.slots.empty()) {
+		slot = FindSlot(table, key, hash);
+		if (table.slots[slot].entry != Data::Empty) {
+			table.entries[table.slots[slot].entry].value = std::move(value);
+			return;
+		}
+	}
+	if (table.entries.size() + 1 > table.slots.size() / 4 * 3) {
+		if (table.entries.size() + 1 >= Data::Empty) {
+			fprintf(stderr, "[ERROR] Map is full\n");
+			exit(EXIT_FAILURE);
+		}
+		Grow(table);
+		slot = FindSlot(table, key, hash);
+	}
+	table.slots[slot] = {hash, (uint32_t) table.entries.size()};
+	table.entries.emplace_back();
+	table.entries.back().key   = key;
+	table.entries.back().value = std::move(value);
+}
+
+void Language::Map::Erase(const Value& key) {
+	Data& table = *Table();
+	if (table.entries.empty()) {
+		return;
+	}
+	size_t mask = table.slots.size() - 1;
+	size_t free = FindSlot(table, key, Hash(key));
+	size_t gone = table.slots[free].entry;
+	if (gone == Data::Empty) {
+		return;
+	}
+
+	// slots after the free one move back into it, unless that would put them
+	// before where their probe starts. then no key has a free slot between
+	// where its probe starts and where it is, so every key can still be found
+	table.slots[free].entry = Data::Empty;
+	size_t j = (free + 1) & mask;
+	for (; table.slots[j].entry != Data::Empty; j = (j + 1) & mask) {
+		size_t start = table.slots[j].hash & mask;
+		if (((j - start) & mask) >= ((j - free) & mask)) {
+			table.slots[free]    = table.slots[j];
+			table.slots[j].entry = Data::Empty;
+			free                 = j;
+		}
+	}
+
+	// the last entry fills the gap so the entries stay packed
+	size_t last = table.entries.size() - 1;
+	if (gone != last) {
+		auto& moved = table.entries[last];
+		j = Hash(moved.key) & mask;
+		while (table.slots[j].entry != last) {
+			j = (j + 1) & mask;
+		}
+		table.slots[j].entry = (uint32_t) gone;
+		table.entries[gone]  = std::move(moved);
+	}
+	table.entries.pop_back();
+}
+
+size_t Language::Map::Size() const {
+	return Table()->entries.size();
+}
+
+const Language::Value& Language::Map::KeyAt(size_t index) const {
+	return Table()->entries[index].key;
+}
+
+Language::Value& Language::Map::ValueAt(size_t index) const {
+	return Table()->entries[index].value;
+}
+
+size_t Language::Map::MemoryUsed() const {
+	Data& table = *Table();
+	return
+		sizeof(Data) + table.slots.capacity() * sizeof(Data::Slot) +
+		table.entries.capacity() * sizeof(Data::Entry);
+}
+
+static Language::Map& MapArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (value.GetType() != Language::Type::Map) {
+		BuiltIn::ArgumentTypeError(name, n, "map", value.GetType());
+	}
+	return value.Get <Language::Map>();
+}
+
+static const Language::Value& KeyArgument(
+	Language::LanguageComponents& lc, const char* name, size_t count, size_t n
+) {
+	Language::Value& value = BuiltIn::Argument(lc, count, n);
+	if (!Language::Map::CanBeKey(value.GetType())) {
+		BuiltIn::ArgumentTypeError(name, n, "string/integer/word", value.GetType());
+	}
+	return value;
+}
+
+static size_t EntryArgument(
+	Language::LanguageComponents& lc, const char* name, const Language::Map& map
+) {
+	size_t index = BuiltIn::IndexArgument(lc, name, 2, 2);
+	if (index >= map.Size()) {
+		fprintf(
+			stderr, "[ERROR] %s: Index %llu out of range for map of size %llu\n",
+			name, (unsigned long long int) index, (unsigned long long int) map.Size()
+		);
+		exit(EXIT_FAILURE);
+	}
+	return index;
+}
+
+void BuiltIn::MapNew(Language::LanguageComponents& lc) {
+	lc.returnValues.push_back(Language::Map());
+}
+
+void BuiltIn::MapSet(Language::LanguageComponents& lc) {
+	const char* name = "MapSet";
+	BuiltIn::ExpectArguments(lc, name, 3, "map, string/integer/word, value");
+
+	Language::Map&         map   = MapArgument(lc, name, 3, 1);
+	const Language::Value& key   = KeyArgument(lc, name, 3, 2);
+	Language::Value&       value = BuiltIn::Argument(lc, 3, 3);
+	if (value.GetType() == Language::Type::Err) {
+		BuiltIn::ArgumentTypeError(name, 3, "value", value.GetType());
+	}
+	map.Set(key, std::move(value));
+
+	lc.passStack.resize(lc.passStack.size() - 3);
+}
+
+void BuiltIn::MapGet(Language::LanguageComponents& lc) {
+	const char* name = "MapGet";
+	BuiltIn::ExpectArguments(lc, name, 2, "map, string/integer/word");
+
+	Language::Map&         map   = MapArgument(lc, name, 2, 1);
+	const Language::Value& key   = KeyArgument(lc, name, 2, 2);
+	Language::Value*       value = map.Find(key);
+	if (value == nullptr) {
+		Language::Builder text;
+		BuiltIn::WriteValue(text, key);
+		fprintf(
+			stderr, "[ERROR] %s: Key %s isn't in the map\n",
+			name, text.Freeze().Get().c_str()
+		);
+		exit(EXIT_FAILURE);
+	}
+
+	Language::Value ret = *value;
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(ret));
+}
+
+void BuiltIn::MapHas(Language::LanguageComponents& lc) {
+	const char* name = "MapHas";
+	BuiltIn::ExpectArguments(lc, name, 2, "map, string/integer/word");
+
+	Language::Map& map = MapArgument(lc, name, 2, 1);
+	bool           has = map.Find(KeyArgument(lc, name, 2, 2)) != nullptr;
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(has);
+}
+
+// deleting a key that isn't in the map does nothing
+void BuiltIn::MapDelete(Language::LanguageComponents& lc) {
+	const char* name = "MapDelete";
+	BuiltIn::ExpectArguments(lc, name, 2, "map, string/integer/word");
+
+	MapArgument(lc, name, 2, 1).Erase(KeyArgument(lc, name, 2, 2));
+	lc.passStack.resize(lc.passStack.size() - 2);
+}
+
+void BuiltIn::MapSize(Language::LanguageComponents& lc) {
+	const char* name = "MapSize";
+	BuiltIn::ExpectArguments(lc, name, 1, "map");
+
+	int32_t size = (int32_t) MapArgument(lc, name, 1, 1).Size();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(size);
+}
+
+// map_key_at and map_value_at iterate over a map by index, from 0 to its
+// size - 1. map_delete moves the last entry into the deleted one's index
+void BuiltIn::MapKeyAt(Language::LanguageComponents& lc) {
+	const char* name = "MapKeyAt";
+	BuiltIn::ExpectArguments(lc, name, 2, "map, integer/word");
+
+	Language::Map&  map = MapArgument(lc, name, 2, 1);
+	Language::Value ret = map.KeyAt(EntryArgument(lc, name, map));
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(ret));
+}
+
+void BuiltIn::MapValueAt(Language::LanguageComponents& lc) {
+	const char* name = "MapValueAt";
+	BuiltIn::ExpectArguments(lc, name, 2, "map, integer/word");
+
+	Language::Map&  map = MapArgument(lc, name, 2, 1);
+	Language::Value ret = map.ValueAt(EntryArgument(lc, name, map));
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(std::move(ret));
+}
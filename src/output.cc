@@ -0,0 +1,132 @@
+#include "output.hh"
+#include <mutex>
+
+// buffers that still have to be flushed if the program calls exit(). spawned
+// labels use theirs on other threads, which keep running while exit() runs,
+// so only the calling thread's buffers are flushed, and the list is never
+// freed in case another thread's buffer goes after exit() has started
+static std::vector <Output::Buffer*>& liveBuffers = *new std::vector <Output::Buffer*>();
+static std::mutex&                    liveLock    = *new std::mutex();
+
+static void FlushLiveBuffers() {
+	std::lock_guard <std::mutex> held(liveLock);
+	for (auto buffer : liveBuffers) {
+		if (buffer->User() == std::this_thread::get_id()) {
+			buffer->Flush();
+		}
+	}
+}
+
+static void WriteAll(int fd, const char* text, size_t length) {
+	while (length > 0) {
+		ssize_t written = write(fd, text, length);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		text   += written;
+		length -= (size_t) written;
+	}
+}
+
+// errors go to stderr, which isn't buffered, so what the program printed
+// before them is written first. they'd come out ahead of it otherwise when
+// stdout is a pipe or a file
+#ifdef __GLIBC__
+static ssize_t WriteError(void*, const char* text, size_t length) {
+	FlushLiveBuffers();
+	WriteAll(STDERR_FILENO, text, length);
+	return (ssize_t) length;
+}
+#endif
+
+static void OrderErrors() {
+#ifdef __GLIBC__
+	cookie_io_functions_t functions = {nullptr, WriteError, nullptr, nullptr};
+	FILE*                 errors    = fopencookie(nullptr, "w", functions);
+	if (errors != nullptr) {
+		setvbuf(errors, nullptr, _IONBF, 0);
+		stderr = errors;
+	}
+#endif
+}
+
+Output::Buffer::Buffer(int p_fd, bool p_owned):
+	mode(isatty(p_fd)? Mode::Line : Mode::Full),
+	fd(p_fd),
+	owned(p_owned),
+	user(std::this_thread::get_id()),
+	data(new char[capacity]),
+	length(0)
+{
+	std::lock_guard <std::mutex> held(liveLock);
+	static bool registered = false;
+	if (!registered) {
+		atexit(FlushLiveBuffers);
+		OrderErrors();
+		registered = true;
+	}
+	liveBuffers.push_back(this);
+}
+
+Output::Buffer::~Buffer() {
+	Flush();
+	{
+		std::lock_guard <std::mutex> held(liveLock);
+		liveBuffers.erase(std::find(liveBuffers.begin(), liveBuffers.end(), this));
+	}
+	if (owned) {
+		close(fd);
+	}
+}
+
+void Output::Buffer::Write(std::string_view text) {
+	if (length + text.length() > capacity) {
+		Flush();
+		if (text.length() > capacity) {
+			WriteAll(fd, text.data(), text.length());
+			return;
+		}
+	}
+	memcpy(data.get() + length, text.data(), text.length());
+	length += text.length();
+
+	if ((mode == Mode::Line) && (memchr(text.data(), '\n', text.length()) != nullptr)) {
+		Flush();
+	}
+}
+
+void Output::Buffer::Write(int32_t value) {
+	char text[16];
+	auto result = std::to_chars(text, text + sizeof(text), value);
+	Write(std::string_view(text, result.ptr - text));
+}
+
+void Output::Buffer::Write(double value) {
+	// same as %g
+	char text[32];
+	auto result = std::to_chars(
+		text, text + sizeof(text), value, std::chars_format::general, 6
+	);
+	Write(std::string_view(text, result.ptr - text));
+}
+
+void Output::Buffer::Write(long long int value) {
+	char text[24];
+	auto result = std::to_chars(text, text + sizeof(text), value);
+	Write(std::string_view(text, result.ptr - text));
+}
+
+void Output::Buffer::Flush() {
+	// anything printed through stdio has to come out first
+	fflush(stdout);
+	WriteAll(fd, data.get(), length);
+	length = 0;
+}
+
+void Output::Buffer::Adopt() {
+	std::lock_guard <std::mutex> held(liveLock);
+	user = std::this_thread::get_id();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "_components.hh"
+#include <unistd.h>
+
+namespace Output {
+	enum class Mode {
+		Line = 0, // flushed after every newline, for terminals
+		Full      // flushed when the buffer fills up, for pipes and files
+	};
+	// batches everything the program prints into as few writes to stdout, or
+	// to a file opened with file_open, as possible. anything left in a buffer
+	// is flushed when the process exits, or before anything is written to
+	// stderr, by the thread that uses it
+	class Buffer {
+		public:
+			// fd is closed with the buffer if owned
+			Buffer(int p_fd = STDOUT_FILENO, bool p_owned = false);
+			~Buffer();
+			Buffer(const Buffer&)            = delete;
+			Buffer& operator=(const Buffer&) = delete;
+
+			void Write(std::string_view text);
+			void Write(int32_t value);
+			void Write(double value);
+			void Write(long long int value);
+			void Flush();
+			// the calling thread uses the buffer from now on, it's the thread
+			// that made it until then
+			void Adopt();
+			std::thread::id User() const {
+				return user;
+			}
+
+			Mode mode;
+
+		private:
+			static constexpr size_t capacity = 65536;
+
+			int                      fd;
+			bool                     owned;
+			std::thread::id          user;
+			std::unique_ptr <char[]> data;
+			size_t                   length;
+	};
+}
@@ -0,0 +1,92 @@
+#include "pool.hh"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+enum class State {
+	Queued,
+	Running,
+	Done
+};
+
+class Pool::Job {
+	public:
+		std::function <void()> work;
+		State                  state;
+};
+
+// one lock covers the queue and every job's state, jobs are big enough that
+// it's never held for long compared to them. it's never freed, exit() can be
+// called from a job while other threads wait on the pool, and freeing a
+// condition variable waits for its waiters
+struct Shared {
+	std::mutex                              lock;
+	std::condition_variable                 queued;
+	std::condition_variable                 finished;
+	std::deque <std::shared_ptr <Pool::Job>> jobs;
+	size_t                                  workers = 0;
+	bool                                    started = false;
+};
+static Shared& pool = *new Shared();
+
+static void Run(Pool::Job& job, std::unique_lock <std::mutex>& held) {
+	job.state = State::Running;
+	held.unlock();
+	job.work();
+	job.work = nullptr;
+	held.lock();
+	job.state = State::Done;
+	pool.finished.notify_all();
+}
+
+static void Worker() {
+	std::unique_lock <std::mutex> held(pool.lock);
+	while (true) {
+		pool.queued.wait(held, []() {
+			return !pool.jobs.empty();
+		});
+		std::shared_ptr <Pool::Job> job = pool.jobs.front();
+		pool.jobs.pop_front();
+		Run(*job, held);
+	}
+}
+
+void Pool::SetWorkers(size_t count) {
+	std::lock_guard <std::mutex> held(pool.lock);
+	pool.workers = count;
+}
+
+std::shared_ptr <Pool::Job> Pool::Queue(std::function <void()> work) {
+	auto job = std::make_shared <Job>();
+	job->work  = std::move(work);
+	job->state = State::Queued;
+
+	std::lock_guard <std::mutex> held(pool.lock);
+	if (!pool.started) {
+		// the workers are never joined, they wait for jobs until the process
+		// exits
+		size_t count = pool.workers;
+		if (count == 0) {
+			count = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		for (size_t j = 0; j < count; ++j) {
+			std::thread(Worker).detach();
+		}
+		pool.started = true;
+	}
+	pool.jobs.push_back(job);
+	pool.queued.notify_one();
+	return job;
+}
+
+void Pool::Wait(const std::shared_ptr <Job>& job) {
+	std::unique_lock <std::mutex> held(pool.lock);
+	if (job->state == State::Queued) {
+		pool.jobs.erase(std::find(pool.jobs.begin(), pool.jobs.end(), job));
+		Run(*job, held);
+		return;
+	}
+	pool.finished.wait(held, [&]() {
+		return job->state == State::Done;
+	});
+}
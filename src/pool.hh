@@ -0,0 +1,17 @@
+#pragma once
+#include "_components.hh"
+#include <functional>
+
+// a fixed set of worker threads that run queued jobs, started when the first
+// job is queued. a job no worker has started yet is run by the thread that
+// waits for it, so jobs that wait on other jobs can't use up the workers
+namespace Pool {
+	class Job;
+
+	// 0, the default, is one worker per core. only has an effect before the
+	// first job is queued
+	void                  SetWorkers(size_t count);
+	std::shared_ptr <Job> Queue(std::function <void()> work);
+	// returns once the job has run
+	void                  Wait(const std::shared_ptr <Job>& job);
+}
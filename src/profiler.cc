@@ -0,0 +1,161 @@
+#include "profiler.hh"
+
+Profiler::Recorder::Recorder(std::string root):
+	finished(false)
+{
+	// the root label is entered when the program starts and never returns
+	entries.push_back({root, true, 1, 0, 0, 0});
+	nodes.push_back({0, 0, {}});
+	Enter(0);
+}
+
+size_t Profiler::Recorder::FindLabel(size_t address) {
+	auto it = labels.find(address);
+	return (it == labels.end())? Profiler::NoEntry : it->second;
+}
+
+size_t Profiler::Recorder::AddLabel(size_t address, std::string name) {
+	entries.push_back({name, true, 0, 0, 0, 0});
+	labels[address] = entries.size() - 1;
+	return entries.size() - 1;
+}
+
+size_t Profiler::Recorder::FindBuiltin(const void* function) {
+	auto it = builtins.find(function);
+	return (it == builtins.end())? Profiler::NoEntry : it->second;
+}
+
+size_t Profiler::Recorder::AddBuiltin(const void* function, std::string name) {
+	entries.push_back({name, false, 0, 0, 0, 0});
+	builtins[function] = entries.size() - 1;
+	return entries.size() - 1;
+}
+
+void Profiler::Recorder::Enter(size_t entry) {
+	Frame frame;
+	frame.entry     = entry;
+	frame.node      = 0;
+	frame.childTime = 0;
+
+	if (entries[entry].active > 0) {
+		// recursion is folded into the outermost call, otherwise the call
+		// tree would be as deep as the recursion
+		for (size_t j = frames.size(); j > 0; -- j) {
+			if (frames[j - 1].entry == entry) {
+				frame.node = frames[j - 1].node;
+				break;
+			}
+		}
+		++ entries[entry].calls;
+	}
+	else if (!frames.empty()) {
+		Node& parent = nodes[frames.back().node];
+		for (auto child : parent.children) {
+			if (nodes[child].entry == entry) {
+				frame.node = child;
+				break;
+			}
+		}
+		if (frame.node == 0) {
+			nodes.push_back({entry, 0, {}});
+			nodes[frames.back().node].children.push_back(nodes.size() - 1);
+			frame.node = nodes.size() - 1;
+		}
+		++ entries[entry].calls;
+	}
+	++ entries[entry].active;
+
+	frames.push_back(frame);
+	// taken last so the bookkeeping isn't timed
+	frames.back().start = Clock::now();
+}
+
+void Profiler::Recorder::Leave() {
+	auto   now     = Clock::now();
+	Frame  frame   = frames.back();
+	Entry& entry   = entries[frame.entry];
+	frames.pop_back();
+
+	int64_t elapsed = std::chrono::duration_cast <std::chrono::nanoseconds>(
+		now - frame.start
+	).count();
+
+	// recursive calls are already inside the outermost call's time
+	-- entry.active;
+	if (entry.active == 0) {
+		entry.inclusive += elapsed;
+	}
+	entry.exclusive            += elapsed - frame.childTime;
+	nodes[frame.node].exclusive += elapsed - frame.childTime;
+	if (!frames.empty()) {
+		frames.back().childTime += elapsed;
+	}
+}
+
+void Profiler::Recorder::Finish() {
+	if (finished) {
+		return;
+	}
+	finished = true;
+
+	// the program can exit from inside any call
+	while (!frames.empty()) {
+		Leave();
+	}
+}
+
+void Profiler::Recorder::PrintTable(FILE* file) {
+	Finish();
+
+	std::vector <Entry*> sorted;
+	int64_t              total = 0;
+	for (auto& entry : entries) {
+		sorted.push_back(&entry);
+		total += entry.exclusive;
+	}
+	std::sort(sorted.begin(), sorted.end(), [](Entry* a, Entry* b) {
+		return a->exclusive > b->exclusive;
+	});
+
+	fprintf(
+		file, "%-24s %-8s %12s %14s %14s %7s\n",
+		"name", "kind", "calls", "inclusive ms", "exclusive ms", "%"
+	);
+	for (auto entry : sorted) {
+		fprintf(
+			file, "%-24s %-8s %12llu %14.3f %14.3f %6.1f%%\n",
+			entry->name.c_str(), entry->isLabel? "label" : "builtin",
+			(unsigned long long int) entry->calls,
+			(double) entry->inclusive / 1e6, (double) entry->exclusive / 1e6,
+			(total == 0)? 0.0 : (double) entry->exclusive * 100 / (double) total
+		);
+	}
+}
+
+void Profiler::Recorder::WriteFolded(std::string path) {
+	Finish();
+
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		fprintf(stderr, "[ERROR] Couldn't write %s: %s\n", path.c_str(), strerror(errno));
+		return;
+	}
+	std::string stack;
+	WriteFolded(file, 0, stack);
+	fclose(file);
+}
+
+void Profiler::Recorder::WriteFolded(FILE* file, size_t node, std::string& stack) {
+	size_t length = stack.length();
+	if (length != 0) {
+		stack += ';';
+	}
+	stack += entries[nodes[node].entry].name;
+	if (nodes[node].exclusive > 0) {
+		fprintf(file, "%s %lld\n", stack.c_str(), (long long int) nodes[node].exclusive);
+	}
+	for (auto child : nodes[node].children) {
+		WriteFolded(file, child, stack);
+	}
+	stack.resize(length);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "_components.hh"
+
+namespace Profiler {
+	typedef std::chrono::steady_clock Clock;
+	constexpr size_t NoEntry = (size_t) -1;
+
+	struct Entry {
+		std::string name;
+		bool        isLabel;
+		size_t      calls;
+		size_t      active; // times it is on the call stack, for recursion
+		int64_t     inclusive; // nanoseconds
+		int64_t     exclusive;
+	};
+	// a path through the calls, for the folded stacks
+	struct Node {
+		size_t               entry;
+		int64_t              exclusive;
+		std::vector <size_t> children;
+	};
+	struct Frame {
+		size_t            entry;
+		size_t            node;
+		Clock::time_point start;
+		int64_t           childTime;
+	};
+
+	// records how often and for how long every label and builtin runs,
+	// entries are looked up by the label address or builtin function
+	class Recorder {
+		public:
+			Recorder(std::string root);
+
+			size_t FindLabel(size_t address);
+			size_t AddLabel(size_t address, std::string name);
+			size_t FindBuiltin(const void* function);
+			size_t AddBuiltin(const void* function, std::string name);
+			void   Enter(size_t entry);
+			void   Leave();
+
+			// closes the frames still open and reports
+			void PrintTable(FILE* file);
+			void WriteFolded(std::string path);
+
+		private:
+			void Finish();
+			void WriteFolded(FILE* file, size_t node, std::string& stack);
+
+			std::vector <Entry>                      entries;
+			std::vector <Node>                       nodes;
+			std::vector <Frame>                      frames;
+			std::unordered_map <size_t, size_t>      labels;
+			std::unordered_map <const void*, size_t> builtins;
+			bool                                     finished;
+	};
+}
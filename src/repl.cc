@@ -1,6 +1,8 @@
 #include "repl.hh"
 #include "language.hh"
 #include "interpreter.hh"
+#include "checker.hh"
+#include "builtin.hh"
 
 void Repl() {
 	std::string                  input;
@@ -8,45 +10,30 @@ void Repl() {
 	lc.Init({}, "REPL");
 	while (true) {
 		fputs("> ", stdout);
-		std::getline(std::cin, input, '\n');
+		if (!std::getline(std::cin, input, '\n')) {
+			break;
+		}
 		if (input.empty()) {
 			continue;
 		}
-		std::vector <Lexer::Token> tokens = Lexer::Lex(input, "REPL");
-		lc.i = lc.tokens.size();
-		for (auto& token : tokens) {
-			lc.tokens.push_back(token);
-		}
+		// every line stays alive, compiled code keeps pointing into it
+		auto source = std::make_shared <FS::File::Source>(input);
+		lc.EditProgram().sources.push_back(source);
+		std::vector <Lexer::Token> tokens = Lexer::Lex(source->View(), "REPL");
+		lc.i = lc.program->code.size();
+		Bytecode::Compile(lc, std::move(tokens));
+		Checker::Check(lc, lc.i);
+		Bytecode::Optimise(lc, lc.i);
 
-		Interpret(lc, false);
+		Interpret(lc, 0);
 
 		if (!lc.returnValues.empty()) {
-			Language::Variable ret = lc.returnValues.back();
+			Language::Value ret = lc.returnValues.back();
 			lc.returnValues.pop_back();
 
-			switch (ret.type) {
-				case Language::Type::String: {
-					puts(std::get <std::string>(ret.value).c_str());
-					break;
-				}
-				case Language::Type::Integer: {
-					printf("%i\n", std::get <int32_t>(ret.value));
-					break;
-				}
-				case Language::Type::Float: {
-					printf("%g\n", std::get <double>(ret.value));
-					break;
-				}
-				case Language::Type::Bool: {
-					puts(std::get <bool>(ret.value)? "true" : "false");
-					break;
-				}
-				case Language::Type::Word: {
-					printf("%lld\n", (long long int) std::get <size_t>(ret.value));
-					break;
-				}
-				default: break;
-			}
+			BuiltIn::WriteValue(lc.output, ret);
+			lc.output.Write("\n");
 		}
+		lc.output.Flush();
 	}
 }
@@ -0,0 +1,345 @@
+#include "simd.hh"
+
+#ifdef __x86_64__
+	#define X86_KERNELS
+	#include <immintrin.h>
+#endif
+
+static size_t ScalarFindByte(const char* str, size_t length, char ch) {
+	for (size_t j = 0; j < length; ++j) {
+		if (str[j] == ch) {
+			return j;
+		}
+	}
+	return SIMD::NotFound;
+}
+
+static size_t ScalarFind(
+	const char* str, size_t length, const char* needle, size_t needleLength
+) {
+	if (needleLength > length) {
+		return SIMD::NotFound;
+	}
+	for (size_t j = 0; j <= length - needleLength; ++j) {
+		if ((str[j] == needle[0]) && (memcmp(str + j, needle, needleLength) == 0)) {
+			return j;
+		}
+	}
+	return SIMD::NotFound;
+}
+
+static size_t ScalarCountByte(const char* str, size_t length, char ch) {
+	size_t count = 0;
+	for (size_t j = 0; j < length; ++j) {
+		count += str[j] == ch;
+	}
+	return count;
+}
+
+static size_t ScalarMismatch(const char* a, const char* b, size_t length) {
+	for (size_t j = 0; j < length; ++j) {
+		if (a[j] != b[j]) {
+			return j;
+		}
+	}
+	return length;
+}
+
+static void ScalarChangeCase(char* str, size_t length, bool upper) {
+	char from = upper? 'a' : 'A';
+	for (size_t j = 0; j < length; ++j) {
+		// letters are 32 apart, and only one bit differs
+		if ((unsigned char) (str[j] - from) < 26) {
+			str[j] ^= 0x20;
+		}
+	}
+}
+
+const SIMD::Kernels SIMD::scalar = {
+	"scalar",
+	ScalarFindByte, ScalarFind, ScalarCountByte, ScalarMismatch, ScalarChangeCase
+};
+
+#ifdef X86_KERNELS
+// the SSE2 and AVX2 kernels are the same apart from the vector width, each
+// one does whole vectors and leaves the tail to the next narrower kernel,
+// short strings would otherwise never reach the vector loop. Vector wraps
+// the intrinsics for one width so the kernels can be written once
+
+struct SSE2 {
+	typedef __m128i Type;
+	static constexpr size_t size = 16;
+
+	static Type Load(const char* p) {
+		return _mm_loadu_si128((const __m128i*) p);
+	}
+	static void Store(char* p, Type v) {
+		_mm_storeu_si128((__m128i*) p, v);
+	}
+	static Type Splat(char ch) {
+		return _mm_set1_epi8(ch);
+	}
+	static Type Equal(Type a, Type b) {
+		return _mm_cmpeq_epi8(a, b);
+	}
+	static uint32_t Mask(Type v) {
+		return (uint32_t) _mm_movemask_epi8(v);
+	}
+	static Type And(Type a, Type b) {
+		return _mm_and_si128(a, b);
+	}
+	static Type Xor(Type a, Type b) {
+		return _mm_xor_si128(a, b);
+	}
+	static Type Add(Type a, Type b) {
+		return _mm_add_epi8(a, b);
+	}
+	static Type Greater(Type a, Type b) {
+		return _mm_cmpgt_epi8(a, b);
+	}
+	static Type Sub(Type a, Type b) {
+		return _mm_sub_epi8(a, b);
+	}
+	// of the bytes
+	static size_t Sum(Type v) {
+		__m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+		return (size_t) _mm_cvtsi128_si32(sums) + (size_t) _mm_extract_epi16(sums, 4);
+	}
+};
+
+// every AVX2 function has to be compiled for AVX2, even the inlined ones.
+// the kernel templates take and return AVX2 vectors without being compiled
+// for AVX2 themselves, which would change the ABI if they weren't always
+// inlined into AVX2 functions
+#define AVX2_TARGET __attribute__((target("avx2")))
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+struct AVX2 {
+	typedef __m256i Type;
+	static constexpr size_t size = 32;
+
+	AVX2_TARGET static Type Load(const char* p) {
+		return _mm256_loadu_si256((const __m256i*) p);
+	}
+	AVX2_TARGET static void Store(char* p, Type v) {
+		_mm256_storeu_si256((__m256i*) p, v);
+	}
+	AVX2_TARGET static Type Splat(char ch) {
+		return _mm256_set1_epi8(ch);
+	}
+	AVX2_TARGET static Type Equal(Type a, Type b) {
+		return _mm256_cmpeq_epi8(a, b);
+	}
+	AVX2_TARGET static uint32_t Mask(Type v) {
+		return (uint32_t) _mm256_movemask_epi8(v);
+	}
+	AVX2_TARGET static Type And(Type a, Type b) {
+		return _mm256_and_si256(a, b);
+	}
+	AVX2_TARGET static Type Xor(Type a, Type b) {
+		return _mm256_xor_si256(a, b);
+	}
+	AVX2_TARGET static Type Add(Type a, Type b) {
+		return _mm256_add_epi8(a, b);
+	}
+	AVX2_TARGET static Type Greater(Type a, Type b) {
+		return _mm256_cmpgt_epi8(a, b);
+	}
+	AVX2_TARGET static Type Sub(Type a, Type b) {
+		return _mm256_sub_epi8(a, b);
+	}
+	AVX2_TARGET static size_t Sum(Type v) {
+		__m256i sums = _mm256_sad_epu8(v, _mm256_setzero_si256());
+		return
+			(size_t) _mm256_extract_epi64(sums, 0) + (size_t) _mm256_extract_epi64(sums, 1) +
+			(size_t) _mm256_extract_epi64(sums, 2) + (size_t) _mm256_extract_epi64(sums, 3);
+	}
+};
+
+template <typename Vector>
+static inline __attribute__((always_inline)) size_t FindByte(
+	const char* str, size_t length, char ch
+) {
+	auto   splat = Vector::Splat(ch);
+	size_t j     = 0;
+	for (; j + Vector::size <= length; j += Vector::size) {
+		uint32_t mask = Vector::Mask(Vector::Equal(Vector::Load(str + j), splat));
+		if (mask != 0) {
+			return j + __builtin_ctz(mask);
+		}
+	}
+	size_t rest;
+	if constexpr (Vector::size > SSE2::size) {
+		rest = FindByte <SSE2>(str + j, length - j, ch);
+	}
+	else {
+		rest = ScalarFindByte(str + j, length - j, ch);
+	}
+	return (rest == SIMD::NotFound)? rest : j + rest;
+}
+
+// candidates are where both the first and the last byte of the needle match,
+// which rules out nearly every position before anything is compared
+template <typename Vector>
+static inline __attribute__((always_inline)) size_t Find(
+	const char* str, size_t length, const char* needle, size_t needleLength
+) {
+	size_t last = needleLength - 1;
+	if (length < last + Vector::size) {
+		return ScalarFind(str, length, needle, needleLength);
+	}
+
+	auto   first = Vector::Splat(needle[0]);
+	auto   end   = Vector::Splat(needle[last]);
+	size_t j     = 0;
+	for (; j + last + Vector::size <= length; j += Vector::size) {
+		uint32_t mask = Vector::Mask(Vector::And(
+			Vector::Equal(Vector::Load(str + j), first),
+			Vector::Equal(Vector::Load(str + j + last), end)
+		));
+		while (mask != 0) {
+			size_t at = j + __builtin_ctz(mask);
+			if (memcmp(str + at + 1, needle + 1, last) == 0) {
+				return at;
+			}
+			mask &= mask - 1;
+		}
+	}
+	size_t rest;
+	if constexpr (Vector::size > SSE2::size) {
+		rest = Find <SSE2>(str + j, length - j, needle, needleLength);
+	}
+	else {
+		rest = ScalarFind(str + j, length - j, needle, needleLength);
+	}
+	return (rest == SIMD::NotFound)? rest : j + rest;
+}
+
+template <typename Vector>
+static inline __attribute__((always_inline)) size_t CountByte(
+	const char* str, size_t length, char ch
+) {
+	auto   splat = Vector::Splat(ch);
+	size_t count = 0;
+	size_t j     = 0;
+	// matches are counted in each byte of a vector, which holds up to 255
+	while (j + Vector::size <= length) {
+		auto   counts = Vector::Splat(0);
+		size_t end    = std::min(length, j + 255 * Vector::size);
+		for (; j + Vector::size <= end; j += Vector::size) {
+			// a match is -1
+			counts = Vector::Sub(counts, Vector::Equal(Vector::Load(str + j), splat));
+		}
+		count += Vector::Sum(counts);
+	}
+	if constexpr (Vector::size > SSE2::size) {
+		return count + CountByte <SSE2>(str + j, length - j, ch);
+	}
+	return count + ScalarCountByte(str + j, length - j, ch);
+}
+
+template <typename Vector>
+static inline __attribute__((always_inline)) size_t Mismatch(
+	const char* a, const char* b, size_t length
+) {
+	size_t j = 0;
+	for (; j + Vector::size <= length; j += Vector::size) {
+		uint32_t mask =
+			Vector::Mask(Vector::Equal(Vector::Load(a + j), Vector::Load(b + j)));
+		if (mask != (uint32_t) ((1ull << Vector::size) - 1)) {
+			return j + __builtin_ctz(~mask);
+		}
+	}
+	if constexpr (Vector::size > SSE2::size) {
+		return j + Mismatch <SSE2>(a + j, b + j, length - j);
+	}
+	return j + ScalarMismatch(a + j, b + j, length - j);
+}
+
+// there is no unsigned byte compare, so the range check is done signed
+// after moving the range to start at -128
+template <typename Vector>
+static inline __attribute__((always_inline)) void ChangeCase(
+	char* str, size_t length, bool upper
+) {
+	auto   shift = Vector::Splat((char) (-128 - (upper? 'a' : 'A')));
+	auto   limit = Vector::Splat((char) (-128 + 25));
+	auto   bit   = Vector::Splat(0x20);
+	size_t j     = 0;
+	for (; j + Vector::size <= length; j += Vector::size) {
+		auto chars = Vector::Load(str + j);
+		auto other = Vector::Greater(Vector::Add(chars, shift), limit);
+		Vector::Store(str + j, Vector::Xor(chars, Vector::And(
+			Vector::Xor(other, Vector::Splat((char) -1)), bit
+		)));
+	}
+	if constexpr (Vector::size > SSE2::size) {
+		ChangeCase <SSE2>(str + j, length - j, upper);
+	}
+	else {
+		ScalarChangeCase(str + j, length - j, upper);
+	}
+}
+
+static size_t SSE2FindByte(const char* str, size_t length, char ch) {
+	return FindByte <SSE2>(str, length, ch);
+}
+static size_t SSE2Find(
+	const char* str, size_t length, const char* needle, size_t needleLength
+) {
+	return Find <SSE2>(str, length, needle, needleLength);
+}
+static size_t SSE2CountByte(const char* str, size_t length, char ch) {
+	return CountByte <SSE2>(str, length, ch);
+}
+static size_t SSE2Mismatch(const char* a, const char* b, size_t length) {
+	return Mismatch <SSE2>(a, b, length);
+}
+static void SSE2ChangeCase(char* str, size_t length, bool upper) {
+	ChangeCase <SSE2>(str, length, upper);
+}
+
+AVX2_TARGET static size_t AVX2FindByte(const char* str, size_t length, char ch) {
+	return FindByte <AVX2>(str, length, ch);
+}
+AVX2_TARGET static size_t AVX2Find(
+	const char* str, size_t length, const char* needle, size_t needleLength
+) {
+	return Find <AVX2>(str, length, needle, needleLength);
+}
+AVX2_TARGET static size_t AVX2CountByte(const char* str, size_t length, char ch) {
+	return CountByte <AVX2>(str, length, ch);
+}
+AVX2_TARGET static size_t AVX2Mismatch(const char* a, const char* b, size_t length) {
+	return Mismatch <AVX2>(a, b, length);
+}
+AVX2_TARGET static void AVX2ChangeCase(char* str, size_t length, bool upper) {
+	ChangeCase <AVX2>(str, length, upper);
+}
+
+static const SIMD::Kernels sse2 = {
+	"sse2", SSE2FindByte, SSE2Find, SSE2CountByte, SSE2Mismatch, SSE2ChangeCase
+};
+static const SIMD::Kernels avx2 = {
+	"avx2", AVX2FindByte, AVX2Find, AVX2CountByte, AVX2Mismatch, AVX2ChangeCase
+};
+#endif
+
+std::vector <const SIMD::Kernels*> SIMD::Supported() {
+	std::vector <const SIMD::Kernels*> ret = {&SIMD::scalar};
+#ifdef X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		ret.push_back(&sse2);
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		ret.push_back(&avx2);
+	}
+#endif
+	return ret;
+}
+
+const SIMD::Kernels& SIMD::Best() {
+	static const SIMD::Kernels* best = SIMD::Supported().back();
+	return *best;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "_components.hh"
+
+// byte string kernels for the string builtins, in SSE2 and AVX2 versions on
+// x86 and a scalar version that runs everywhere. the fastest version the CPU
+// supports is picked when the program starts
+namespace SIMD {
+	constexpr size_t NotFound = (size_t) -1;
+	struct Kernels {
+		const char* name;
+		// index of the first ch in str, or NotFound
+		size_t (*findByte)(const char* str, size_t length, char ch);
+		// index of the first needle in str, or NotFound, needleLength isn't 0
+		size_t (*find)(
+			const char* str, size_t length, const char* needle, size_t needleLength
+		);
+		size_t (*countByte)(const char* str, size_t length, char ch);
+		// index of the first byte that differs, length if there is none
+		size_t (*mismatch)(const char* a, const char* b, size_t length);
+		// ASCII letters only, in place
+		void   (*changeCase)(char* str, size_t length, bool upper);
+	};
+
+	extern const Kernels scalar;
+	// every set of kernels this CPU can run, the scalar ones first
+	std::vector <const Kernels*> Supported();
+	const Kernels&               Best();
+}
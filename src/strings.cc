@@ -0,0 +1,136 @@
+#include "builtin.hh"
+#include "simd.hh"
+
+// the string builtins, the work is done by the fastest kernels in simd.cc
+// the CPU supports
+
+static const SIMD::Kernels& kernels = SIMD::Best();
+
+void BuiltIn::StrLen(Language::LanguageComponents& lc) {
+	const char* name = "StrLen";
+	BuiltIn::ExpectArguments(lc, name, 1, "string");
+
+	// strings know their length
+	int32_t length = (int32_t) BuiltIn::StringArgument(lc, name, 1, 1).Get().length();
+	lc.passStack.pop_back();
+	lc.returnValues.push_back(length);
+}
+
+// -1 if needle isn't in str
+void BuiltIn::StrFind(Language::LanguageComponents& lc) {
+	const char* name = "StrFind";
+	BuiltIn::ExpectArguments(lc, name, 2, "string, string");
+
+	const std::string& str    = BuiltIn::StringArgument(lc, name, 2, 1).Get();
+	const std::string& needle = BuiltIn::StringArgument(lc, name, 2, 2).Get();
+	size_t             index  = 0;
+	if (needle.length() == 1) {
+		index = kernels.findByte(str.data(), str.length(), needle[0]);
+	}
+	else if (!needle.empty()) {
+		index = kernels.find(str.data(), str.length(), needle.data(), needle.length());
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back((index == SIMD::NotFound)? (int32_t) -1 : (int32_t) index);
+}
+
+// occurrences that don't overlap
+void BuiltIn::StrCount(Language::LanguageComponents& lc) {
+	const char* name = "StrCount";
+	BuiltIn::ExpectArguments(lc, name, 2, "string, string");
+
+	const std::string& str    = BuiltIn::StringArgument(lc, name, 2, 1).Get();
+	const std::string& needle = BuiltIn::StringArgument(lc, name, 2, 2).Get();
+	size_t             count  = 0;
+	if (needle.empty()) {
+		fprintf(stderr, "[ERROR] %s: Can't count empty strings\n", name);
+		exit(EXIT_FAILURE);
+	}
+	if (needle.length() == 1) {
+		count = kernels.countByte(str.data(), str.length(), needle[0]);
+	}
+	else {
+		size_t at = 0;
+		while (true) {
+			size_t found = kernels.find(
+				str.data() + at, str.length() - at, needle.data(), needle.length()
+			);
+			if (found == SIMD::NotFound) {
+				break;
+			}
+			++ count;
+			at += found + needle.length();
+		}
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back((int32_t) count);
+}
+
+// -1, 0 or 1 as first sorts before, the same as or after second, by bytes
+void BuiltIn::StrCompare(Language::LanguageComponents& lc) {
+	const char* name = "StrCompare";
+	BuiltIn::ExpectArguments(lc, name, 2, "string, string");
+
+	const std::string& first  = BuiltIn::StringArgument(lc, name, 2, 1).Get();
+	const std::string& second = BuiltIn::StringArgument(lc, name, 2, 2).Get();
+	size_t             length = std::min(first.length(), second.length());
+	size_t             differ = kernels.mismatch(first.data(), second.data(), length);
+	int32_t            order  = 0;
+	if (differ < length) {
+		order = ((unsigned char) first[differ] < (unsigned char) second[differ])? -1 : 1;
+	}
+	else if (first.length() != second.length()) {
+		order = (first.length() < second.length())? -1 : 1;
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(order);
+}
+
+template <bool end>
+static void StrAffix(Language::LanguageComponents& lc, const char* name) {
+	BuiltIn::ExpectArguments(lc, name, 2, "string, string");
+
+	const std::string& str   = BuiltIn::StringArgument(lc, name, 2, 1).Get();
+	const std::string& affix = BuiltIn::StringArgument(lc, name, 2, 2).Get();
+	bool               has   = false;
+	if (affix.length() <= str.length()) {
+		size_t at = end? str.length() - affix.length() : 0;
+		has = kernels.mismatch(str.data() + at, affix.data(), affix.length()) == affix.length();
+	}
+
+	lc.passStack.resize(lc.passStack.size() - 2);
+	lc.returnValues.push_back(has);
+}
+
+void BuiltIn::StrStartsWith(Language::LanguageComponents& lc) {
+	StrAffix <false>(lc, "StrStartsWith");
+}
+
+void BuiltIn::StrEndsWith(Language::LanguageComponents& lc) {
+	StrAffix <true>(lc, "StrEndsWith");
+}
+
+// in `str = str_upper str` the string is moved in, and isn't copied
+template <bool upper>
+static void StrCase(Language::LanguageComponents& lc, const char* name) {
+	BuiltIn::ExpectArguments(lc, name, 1, "string");
+
+	BuiltIn::StringArgument(lc, name, 1, 1);
+	Language::Value str = std::move(lc.passStack.back());
+	lc.passStack.pop_back();
+	std::string& text = str.Get <Language::String>().Mutable();
+	kernels.changeCase(text.data(), text.length(), upper);
+
+	lc.returnValues.push_back(std::move(str));
+}
+
+void BuiltIn::StrUpper(Language::LanguageComponents& lc) {
+	StrCase <true>(lc, "StrUpper");
+}
+
+void BuiltIn::StrLower(Language::LanguageComponents& lc) {
+	StrCase <false>(lc, "StrLower");
+}
@@ -0,0 +1,209 @@
+#include "builtin.hh"
+
+// spawn and join. a spawned label shares the program, which isn't changed
+// while it's shared, and its string literals, which aren't counted. other
+// strings, arrays, builders and maps count their references without atomics,
+// so the globals and the label's arguments are copied deeply, and join hands
+// its return value back once nothing else can touch it
+
+Language::Task::~Task() {
+	if (job != nullptr) {
+		Pool::Wait(job);
+	}
+}
+
+// copies of the same array, builder or map are copied once, so they're
+// still shared in the copy, and so a map that holds itself can be copied.
+// files stay with the thread that opened them, they're left out
+struct Copier {
+	std::unordered_map <const void*, Language::Value> copies;
+	bool                                              leftOut = false;
+
+	Language::Value* Copied(const void* identity) {
+		auto copy = copies.find(identity);
+		return (copy == copies.end())? nullptr : &copy->second;
+	}
+
+	Language::Value Copy(const Language::Value& value) {
+		switch (value.GetType()) {
+			case Language::Type::String: {
+				return Language::String(value.Get <Language::String>().Get());
+			}
+			case Language::Type::Array: {
+				auto& array = value.Get <Language::Array>();
+				if (auto copy = Copied(array.Identity())) {
+					return *copy;
+				}
+				Language::Array ret(array.GetElement(), array.Length());
+				if (array.Length() != 0) {
+					memcpy(
+						ret.Bytes(), array.Bytes(),
+						array.Length() * Language::ElementSize(array.GetElement())
+					);
+				}
+				if (array.Identity() != nullptr) {
+					copies[array.Identity()] = ret;
+				}
+				return ret;
+			}
+			case Language::Type::Builder: {
+				auto& builder = value.Get <Language::Builder>();
+				if (auto copy = Copied(builder.Identity())) {
+					return *copy;
+				}
+				Language::Builder ret;
+				ret.Write(builder.View());
+				copies[builder.Identity()] = ret;
+				return ret;
+			}
+			case Language::Type::Map: {
+				auto& map = value.Get <Language::Map>();
+				if (auto copy = Copied(map.Identity())) {
+					return *copy;
+				}
+				// copied before its entries, which can hold it
+				Language::Map ret;
+				copies[map.Identity()] = ret;
+				for (size_t j = 0; j < map.Size(); ++j) {
+					Language::Value entry = Copy(map.ValueAt(j));
+					if (entry.GetType() != Language::Type::Err) {
+						ret.Set(Copy(map.KeyAt(j)), std::move(entry));
+					}
+				}
+				return ret;
+			}
+			case Language::Type::File: {
+				leftOut = true;
+				return Language::Value();
+			}
+			default: {
+				return value;
+			}
+		}
+	}
+};
+
+// the task shares the program, its string literals are made literals first
+// so both threads can copy them. a program that's already shared has had
+// that done, the tokens added since it was last shared are done here
+static std::unique_ptr <Language::LanguageComponents> ShareProgram(
+	Language::LanguageComponents& lc, Copier& copier
+) {
+	if (Language::Program* own = lc.OwnProgram()) {
+		for (size_t j = own->literals; j < own->tokens.size(); ++j) {
+			Language::Value& value = own->tokens[j].value;
+			if (value.GetType() == Language::Type::String) {
+				value.Get <Language::String>().MakeLiteral();
+			}
+		}
+		own->literals = own->tokens.size();
+		own->shared   = true;
+	}
+
+	auto ret = std::make_unique <Language::LanguageComponents>();
+	ret->program  = lc.program;
+	ret->fileName = lc.fileName;
+	ret->maxDepth = lc.maxDepth;
+	ret->i        = lc.i;
+
+	ret->variables.reserve(lc.variables.size());
+	for (auto& variable : lc.variables) {
+		ret->variables.push_back(copier.Copy(variable));
+	}
+	return ret;
+}
+
+// spawn label args... runs the label on a worker thread and returns a
+// handle for join, the label gets its arguments like a call would
+void BuiltIn::Spawn(Language::LanguageComponents& lc) {
+	const char* name = "Spawn";
+	// only the label and the arguments pushed for this call are the task's,
+	// there's one push for every token after spawn at the call site
+	auto&  tokens = lc.program->tokens;
+	size_t count  = 0;
+	for (
+		size_t t = lc.program->code[lc.i].token + 1;
+		tokens[t].type != Lexer::TokenType::End; ++t
+	) {
+		++ count;
+	}
+	if ((count == 0) || (lc.passStack.size() < count)) {
+		fprintf(stderr, "[ERROR] %s: expected a label to spawn\n", name);
+		exit(EXIT_FAILURE);
+	}
+	size_t           first = lc.passStack.size() - count;
+	Language::Value& label = lc.passStack[first];
+	if (label.GetType() != Language::Type::Word) {
+		BuiltIn::ArgumentTypeError(name, 1, "word", label.GetType());
+	}
+	size_t address = label.Get <size_t>();
+	if (
+		(address >= lc.program->code.size()) ||
+		(lc.program->code[address].op != Bytecode::Opcode::Nop)
+	) {
+		fprintf(stderr, "[ERROR] %s: Argument 1 isn't a label\n", name);
+		exit(EXIT_FAILURE);
+	}
+	// globals that are files are left out, but arguments can't be
+	Copier copier;
+	auto   worker = ShareProgram(lc, copier);
+	for (size_t j = first + 1; j < lc.passStack.size(); ++j) {
+		copier.leftOut = false;
+		worker->passStack.push_back(copier.Copy(lc.passStack[j]));
+		if (copier.leftOut) {
+			fprintf(
+				stderr, "[ERROR] %s: Argument %llu holds a file, files can't be passed "
+				"to a spawned label\n", name, (unsigned long long int) (j - first + 1)
+			);
+			exit(EXIT_FAILURE);
+		}
+	}
+	lc.passStack.resize(first);
+	// the copies are the worker's values, which this thread can't use once
+	// it's started
+	copier.copies.clear();
+
+	// what was printed before the spawn comes out before what the task prints
+	lc.output.Flush();
+
+	size_t                        handle = lc.nextTask ++;
+	Language::Task&               task   = lc.tasks[handle];
+	Language::LanguageComponents* run    = worker.get();
+	task.lc  = std::move(worker);
+	task.job = Pool::Queue([run, address]() {
+		run->output.Adopt();
+		run->CallLabelAndWait(address);
+		run->output.Flush();
+	});
+
+	lc.returnValues.push_back(handle);
+}
+
+// waits for the task and returns what its label returned, if anything
+void BuiltIn::Join(Language::LanguageComponents& lc) {
+	const char* name = "Join";
+	BuiltIn::ExpectArguments(lc, name, 1, "word");
+
+	Language::Value& handle = BuiltIn::Argument(lc, 1, 1);
+	if (handle.GetType() != Language::Type::Word) {
+		BuiltIn::ArgumentTypeError(name, 1, "word", handle.GetType());
+	}
+	auto task = lc.tasks.find(handle.Get <size_t>());
+	if (task == lc.tasks.end()) {
+		fprintf(
+			stderr, "[ERROR] %s: No task %llu, it was never spawned or is already "
+			"joined\n", name, (unsigned long long int) handle.Get <size_t>()
+		);
+		exit(EXIT_FAILURE);
+	}
+	lc.passStack.pop_back();
+
+	// once the job is done the task's values are only used from here
+	Pool::Wait(task->second.job);
+	task->second.job = nullptr;
+	std::vector <Language::Value>& returned = task->second.lc->returnValues;
+	if (!returned.empty()) {
+		lc.returnValues.push_back(std::move(returned.back()));
+	}
+	lc.tasks.erase(task);
+}
@@ -2,9 +2,6 @@
 #include "_components.hh"
 
 namespace Util {
-	bool        IsInteger(std::string str);
-	bool        IsFloat(std::string str);
-	bool        IsBool(std::string str);
 	std::string BaseName(std::string path);
 	std::string DirName(std::string path);
 }
@@ -0,0 +1,532 @@
+#pragma once
+#include "_components.hh"
+#include "fs.hh"
+#include "output.hh"
+
+namespace Language {
+	enum class Type : uint8_t {
+		String = 0,
+		Integer,
+		Float,
+		Bool,
+		Word,
+		Array,
+		Builder,
+		File,
+		Map,
+		Err
+	};
+	// reference counted, so copying a string value is O(1), the characters
+	// are only copied when a shared string is modified. the count isn't
+	// atomic, a string is only ever used by one thread, except for literals
+	class String {
+		public:
+			String(): data(nullptr) {}
+			String(std::string str): data(new Data {1, std::move(str)}) {}
+			String(const String& other): data(other.data) {
+				if ((data != nullptr) && (data->references != literal)) {
+					++ data->references;
+				}
+			}
+			String(String&& other) noexcept: data(other.data) {
+				other.data = nullptr;
+			}
+			String& operator=(String other) noexcept {
+				std::swap(data, other.data);
+				return *this;
+			}
+			~String() {
+				if (
+					(data != nullptr) && (data->references != literal) &&
+					(-- data->references == 0)
+				) {
+					delete data;
+				}
+			}
+
+			const std::string& Get() const {
+				static const std::string empty;
+				return (data != nullptr)? data->str : empty;
+			}
+			std::string& Mutable() {
+				if (data == nullptr) {
+					data = new Data {1, ""};
+				}
+				else if (data->references > 1) {
+					if (data->references != literal) {
+						-- data->references;
+					}
+					data = new Data {1, data->str};
+				}
+				return data->str;
+			}
+			// the characters are never counted or freed from now on, so any
+			// thread can copy the string, the program's string literals are
+			// made literals before a task shares them
+			void MakeLiteral() {
+				if (data != nullptr) {
+					data->references = literal;
+				}
+			}
+			bool operator==(const String& other) const {
+				return (data == other.data) || (Get() == other.Get());
+			}
+
+		private:
+			static constexpr size_t literal = (size_t) -1;
+
+			struct Data {
+				size_t      references;
+				std::string str;
+			};
+			Data* data;
+	};
+
+	// what an array holds, bytes are read and written as integers
+	enum class Element : uint8_t {
+		Byte = 0,
+		Integer,
+		Word,
+		Float
+	};
+	inline size_t ElementSize(Element element) {
+		switch (element) {
+			case Element::Byte:    return sizeof(uint8_t);
+			case Element::Integer: return sizeof(int32_t);
+			default:               return sizeof(uint64_t);
+		}
+	}
+
+	// a mutable buffer of numbers stored contiguously. unlike strings, copies
+	// of an array share its elements, so builtins can change them in place.
+	// the count isn't atomic either
+	class Array {
+		public:
+			Array(): data(nullptr) {}
+			Array(Element element, size_t length):
+				data(new Data {
+					1, element, std::vector <uint8_t>(length * ElementSize(element))
+				}) {}
+			Array(const Array& other): data(other.data) {
+				if (data != nullptr) {
+					++ data->references;
+				}
+			}
+			Array(Array&& other) noexcept: data(other.data) {
+				other.data = nullptr;
+			}
+			Array& operator=(Array other) noexcept {
+				std::swap(data, other.data);
+				return *this;
+			}
+			~Array() {
+				if ((data != nullptr) && (-- data->references == 0)) {
+					delete data;
+				}
+			}
+
+			// an array that was never created is an empty byte array
+			Element GetElement() const {
+				return (data != nullptr)? data->element : Element::Byte;
+			}
+			size_t Length() const {
+				return (data != nullptr)? data->bytes.size() / ElementSize(data->element) : 0;
+			}
+			uint8_t* Bytes() const {
+				return (data != nullptr)? data->bytes.data() : nullptr;
+			}
+			// T must be the element's type, index must be in range
+			template <typename T> T Load(size_t index) const {
+				T value;
+				memcpy(&value, data->bytes.data() + index * sizeof(T), sizeof(T));
+				return value;
+			}
+			template <typename T> void Store(size_t index, T value) {
+				memcpy(data->bytes.data() + index * sizeof(T), &value, sizeof(T));
+			}
+			// the same for every copy that shares the elements, nullptr for an
+			// array that was never created
+			const void* Identity() const {
+				return data;
+			}
+
+		private:
+			struct Data {
+				size_t               references;
+				Element              element;
+				std::vector <uint8_t> bytes;
+			};
+			Data* data;
+	};
+
+	// text put together from many pieces. appending to a string copies it,
+	// a builder is appended to in place and its buffer grows geometrically,
+	// so appends take amortised O(1) time. like arrays, copies of a builder
+	// share it. it's written to like an Output::Buffer
+	class Builder {
+		public:
+			Builder(): data(new Data {1, ""}) {}
+			Builder(const Builder& other): data(other.data) {
+				++ data->references;
+			}
+			Builder(Builder&& other) noexcept: data(other.data) {
+				other.data = nullptr;
+			}
+			Builder& operator=(Builder other) noexcept {
+				std::swap(data, other.data);
+				return *this;
+			}
+			~Builder() {
+				if ((data != nullptr) && (-- data->references == 0)) {
+					delete data;
+				}
+			}
+
+			void Write(std::string_view text) {
+				data->text.append(text);
+			}
+			void   Write(int32_t value);
+			void   Write(double value);
+			void   Write(long long int value);
+			size_t Length() const {
+				return data->text.length();
+			}
+			std::string_view View() const {
+				return data->text;
+			}
+			// the text so far, which is moved out so the builder is left empty
+			String Freeze();
+			// the same for every copy that shares the text
+			const void* Identity() const {
+				return data;
+			}
+
+		private:
+			struct Data {
+				size_t      references;
+				std::string text;
+			};
+			Data* data;
+	};
+
+	// a file opened by file_open, either read through a reader or written
+	// through a buffer. copies of a file share it, it's closed by file_close
+	// or when the last copy goes
+	class File {
+		public:
+			File(): data(nullptr) {}
+			File(std::unique_ptr <FS::File::Reader> reader):
+				data(new Data {1, std::move(reader), nullptr}) {}
+			File(std::unique_ptr <Output::Buffer> writer):
+				data(new Data {1, nullptr, std::move(writer)}) {}
+			File(const File& other): data(other.data) {
+				if (data != nullptr) {
+					++ data->references;
+				}
+			}
+			File(File&& other) noexcept: data(other.data) {
+				other.data = nullptr;
+			}
+			File& operator=(File other) noexcept {
+				std::swap(data, other.data);
+				return *this;
+			}
+			~File() {
+				if ((data != nullptr) && (-- data->references == 0)) {
+					delete data;
+				}
+			}
+
+			// nullptr if the file isn't open for reading
+			FS::File::Reader* Reader() const {
+				return (data != nullptr)? data->reader.get() : nullptr;
+			}
+			// nullptr if the file isn't open for writing
+			Output::Buffer* Writer() const {
+				return (data != nullptr)? data->writer.get() : nullptr;
+			}
+			// for every copy, anything written is flushed first
+			void Close() {
+				if (data != nullptr) {
+					data->reader.reset();
+					data->writer.reset();
+				}
+			}
+
+		private:
+			struct Data {
+				size_t                             references;
+				std::unique_ptr <FS::File::Reader> reader;
+				std::unique_ptr <Output::Buffer>   writer;
+			};
+			Data* data;
+	};
+
+	class Value;
+
+	// a hash table from strings, integers or words to values, copies of a
+	// map share it. it's open addressed with linear probing: the slots hold
+	// each key's hash and the index of its entry, so most probes compare
+	// hashes in one cache line without touching the keys. the entries are
+	// kept packed in an array, which is also the order they're iterated in.
+	// Map::Data is the table, map.cc has what works on it
+	class Map {
+		public:
+			Map();
+			Map(const Map& other): data(other.data) {
+				if (data != nullptr) {
+					++ data->references;
+				}
+			}
+			Map(Map&& other) noexcept: data(other.data) {
+				other.data = nullptr;
+			}
+			Map& operator=(Map other) noexcept {
+				std::swap(data, other.data);
+				return *this;
+			}
+			~Map(); // after Value, which the table holds
+
+			// key is a string, integer or word, an integer and a word are
+			// different keys even with the same value
+			static bool CanBeKey(Type type) {
+				return
+					(type == Type::String) || (type == Type::Integer) ||
+					(type == Type::Word);
+			}
+			// nullptr if key isn't in the map
+			Value* Find(const Value& key) const;
+			void   Set(const Value& key, Value value);
+			// the last entry is moved into the deleted one's place
+			void   Erase(const Value& key);
+			size_t Size() const;
+			// entries are numbered from 0 to Size() - 1
+			const Value& KeyAt(size_t index) const;
+			Value&       ValueAt(size_t index) const;
+			// bytes allocated for the slots and the entries, which doesn't
+			// count the strings the keys and values point to
+			size_t MemoryUsed() const;
+			// the same for every copy that shares the table
+			const void* Identity() const {
+				return data;
+			}
+
+			struct Data;
+
+		private:
+			struct Shared {
+				size_t references;
+			};
+			Data* Table() const;
+
+			Shared* data;
+	};
+
+	// a value and its type in 16 bytes, strings, arrays, builders, files and
+	// maps are held out of line. a value of type Err holds nothing, it's what
+	// a deleted variable is
+	class Value {
+		public:
+			Value(): type(Type::Err) {
+				word = 0;
+			}
+			Value(int32_t p_integer): type(Type::Integer) {
+				integer = p_integer;
+			}
+			Value(double p_number): type(Type::Float) {
+				number = p_number;
+			}
+			Value(bool p_boolean): type(Type::Bool) {
+				boolean = p_boolean;
+			}
+			Value(size_t p_word): type(Type::Word) {
+				word = p_word;
+			}
+			Value(String p_str): type(Type::String) {
+				new (&str) String(std::move(p_str));
+			}
+			Value(Array p_array): type(Type::Array) {
+				new (&array) Array(std::move(p_array));
+			}
+			Value(Builder p_builder): type(Type::Builder) {
+				new (&builder) Builder(std::move(p_builder));
+			}
+			Value(File p_file): type(Type::File) {
+				new (&file) File(std::move(p_file));
+			}
+			Value(Map p_map): type(Type::Map) {
+				new (&map) Map(std::move(p_map));
+			}
+			// would otherwise be converted to a bool
+			Value(const char*) = delete;
+
+			Value(const Value& other): type(other.type) {
+				if (type == Type::String) {
+					new (&str) String(other.str);
+				}
+				else if (type == Type::Array) {
+					new (&array) Array(other.array);
+				}
+				else if (type == Type::Builder) {
+					new (&builder) Builder(other.builder);
+				}
+				else if (type == Type::File) {
+					new (&file) File(other.file);
+				}
+				else if (type == Type::Map) {
+					new (&map) Map(other.map);
+				}
+				else {
+					word = other.word;
+				}
+			}
+			Value(Value&& other) noexcept: type(other.type) {
+				if (type == Type::String) {
+					new (&str) String(std::move(other.str));
+				}
+				else if (type == Type::Array) {
+					new (&array) Array(std::move(other.array));
+				}
+				else if (type == Type::Builder) {
+					new (&builder) Builder(std::move(other.builder));
+				}
+				else if (type == Type::File) {
+					new (&file) File(std::move(other.file));
+				}
+				else if (type == Type::Map) {
+					new (&map) Map(std::move(other.map));
+				}
+				else {
+					word = other.word;
+				}
+			}
+			Value& operator=(const Value& other) {
+				if (this != &other) {
+					Value copy(other);
+					*this = std::move(copy);
+				}
+				return *this;
+			}
+			Value& operator=(Value&& other) noexcept {
+				if (this == &other) {
+					return *this;
+				}
+				if ((type == Type::String) && (other.type == Type::String)) {
+					str = std::move(other.str);
+					return *this;
+				}
+				Clear();
+				type = other.type;
+				if (type == Type::String) {
+					new (&str) String(std::move(other.str));
+				}
+				else if (type == Type::Array) {
+					new (&array) Array(std::move(other.array));
+				}
+				else if (type == Type::Builder) {
+					new (&builder) Builder(std::move(other.builder));
+				}
+				else if (type == Type::File) {
+					new (&file) File(std::move(other.file));
+				}
+				else if (type == Type::Map) {
+					new (&map) Map(std::move(other.map));
+				}
+				else {
+					word = other.word;
+				}
+				return *this;
+			}
+			~Value() {
+				Clear();
+			}
+
+			Type GetType() const {
+				return type;
+			}
+			// the value must be of type T
+			template <typename T> T&       Get();
+			template <typename T> const T& Get() const {
+				return const_cast <Value*>(this)->Get <T>();
+			}
+
+		private:
+			void Clear() {
+				if (type == Type::String) {
+					str.~String();
+				}
+				else if (type == Type::Array) {
+					array.~Array();
+				}
+				else if (type == Type::Builder) {
+					builder.~Builder();
+				}
+				else if (type == Type::File) {
+					file.~File();
+				}
+				else if (type == Type::Map) {
+					map.~Map();
+				}
+				type = Type::Err;
+				word = 0;
+			}
+
+			union {
+				int32_t integer;
+				double  number;
+				bool    boolean;
+				size_t  word;
+				String  str;
+				Array   array;
+				Builder builder;
+				File    file;
+				Map     map;
+			};
+			Type type;
+	};
+	static_assert(sizeof(Value) == 16);
+
+	template <> inline int32_t& Value::Get <int32_t>() { return integer; }
+	template <> inline double&  Value::Get <double>()  { return number; }
+	template <> inline bool&    Value::Get <bool>()    { return boolean; }
+	template <> inline size_t&  Value::Get <size_t>()  { return word; }
+	template <> inline String&  Value::Get <String>()  { return str; }
+	template <> inline Array&   Value::Get <Array>()   { return array; }
+	template <> inline Builder& Value::Get <Builder>() { return builder; }
+	template <> inline File&    Value::Get <File>()    { return file; }
+	template <> inline Map&     Value::Get <Map>()     { return map; }
+
+	inline Type ValueType(const Value& value) {
+		return value.GetType();
+	}
+
+	// the slots are a power of 2 long, or empty for a map that has never had
+	// a key. a slot's hash is 32 bits of its key's hash, and its low bits are
+	// where the key's probe starts, so the table grows without hashing the
+	// keys again
+	struct Map::Data: Map::Shared {
+		static constexpr uint32_t Empty = UINT32_MAX;
+
+		struct Slot {
+			uint32_t hash;
+			uint32_t entry; // Empty if the slot is free
+		};
+		struct Entry {
+			Value key;
+			Value value;
+		};
+
+		std::vector <Slot>  slots;
+		std::vector <Entry> entries;
+	};
+
+	inline Map::Data* Map::Table() const {
+		return static_cast <Data*>(data);
+	}
+
+	inline Map::~Map() {
+		if ((data != nullptr) && (-- data->references == 0)) {
+			delete Table();
+		}
+	}
+}
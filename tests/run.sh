@@ -0,0 +1,28 @@
+#!/bin/sh
+# runs every program in tests/ and compares what it prints, errors included,
+# and its exit status with the .out file of the same name, once as usual
+# and once with --no-opt, which has to behave the same
+# usage: tests/run.sh atmo
+case "$1" in
+	/*) atmo="$1" ;;
+	*)  atmo="$PWD/$1" ;;
+esac
+cd "$(dirname "$0")" || exit 1
+
+count=0
+failed=0
+for test in *.atmo; do
+	expected="${test%.atmo}.out"
+	for flags in "" "--no-opt"; do
+		count=$((count + 1))
+		# $flags is left unquoted so an empty one disappears
+		actual=$("$atmo" --no-cache $flags "$test" 2>&1; echo "exit $?")
+		if [ "$actual" != "$(cat "$expected")" ]; then
+			echo "FAIL $test $flags"
+			printf '%s\n' "$actual" | diff "$expected" -
+			failed=$((failed + 1))
+		fi
+	done
+done
+echo "$((count - failed))/$count tests passed"
+[ "$failed" -eq 0 ]